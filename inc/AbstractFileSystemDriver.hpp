@@ -1,9 +1,41 @@
 #pragma once
 #include "IFileSystemDriver.hpp"
+#include "FileSystemStats.hpp"
 
 struct AbstractFileSystemDriver : IFileSystemDriver {
-    std::string getFileMd5(const std::string& filename) const override;
+    bool writeContentToFile (std::string_view content, std::string_view filename) const override;
+    bool appendContentToFile (std::string_view content, std::string_view filename) const override;
+    bool readEntireFileToString (std::string_view filename, std::string& output) const override;
+    bool readFileToBuffer(std::string_view filename, std::span<char> buffer, size_t& length) const override;
+    std::vector<std::string> filesList(const std::string& path) const override;
+    uint32_t countFiles (const std::string& path) const override;
+    bool writeMany(const fileContents_t& files) const override;
+    bool deleteMany(const std::vector<std::string>& filenames) const override;
+    /// one directory scan per distinct directory instead of lookup per file
+    std::vector<bool> existsMany(const std::vector<std::string>& filenames) const override;
+    bool getFileSize(std::string_view filename, size_t& size) const override;
+    std::string getFileMd5(std::string_view filename) const override;
+    std::string getFileDigest(std::string_view filename, const eDigestType type) const override;
+    bool isContentVerified(std::string_view filename, const std::string& digest) const override { return false; }
+    void setContentVerified(std::string_view filename, const std::string& digest) const override {}
+    /// streams count bytes and open to close time, drivers implement doOpenForReading and doOpenForWriting
+    fileReader_t openForReading(std::string_view filename) const override;
+    fileWriter_t openForWriting(std::string_view filename, const eWriteMode mode = eWriteMode::WRITE_TRUNCATE) const override;
     bool isReady() const { return _isReady; }
+    /// partition size in bytes, 0 if driver can not tell
+    virtual size_t totalBytes() const { return 0; }
+
+    /// counters of every stream opened through the driver, empty unless CONFIG_ENABLE_FS_DRIVER_STATS is set
+    fsStats_t operationStats() const;
+    void resetOperationStats();
+    /// bytes written through the driver against totalBytes()
+    flashWearEstimate_t flashWearEstimate(const uint32_t ratedEraseCycles = FS_STATS_DEFAULT_RATED_ERASE_CYCLES) const;
 protected:
+    virtual fileReader_t doOpenForReading(std::string_view filename) const = 0;
+    virtual fileWriter_t doOpenForWriting(std::string_view filename, const eWriteMode mode) const = 0;
+    bool doWriteContentToFile(std::string_view content, std::string_view filename, const eWriteMode mode) const;
     bool _isReady{false};
+#if CONFIG_ENABLE_FS_DRIVER_STATS
+    mutable FileSystemStats _fsStats;
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "IFileSystemDriver.hpp"
+#include "task.hpp"
+#include "mutex.hpp"
+#include "freertos/semphr.h"
+#include <functional>
+#include <future>
+#include <list>
+
+#define ASYNC_FILE_IO_DEFAULT_STACK_SIZE    (configMINIMAL_STACK_SIZE * 4)
+#define ASYNC_FILE_IO_MAX_BATCH_SIZE        (4096)
+
+/// runs file operations on dedicated task, callers get callback or future
+/// operations on the same file complete in submission order
+/// reads may overtake queued writes of other files, queued appends to one file are merged into single write
+/// takes ownership of driver, all access to it should go through this class
+class AsyncFileIO : public Task {
+    public:
+        using done_t = std::function<void(const bool)>;
+        using readDone_t = std::function<void(const bool, std::string&)>;
+        using work_t = std::function<void(IFileSystemDriver&)>;
+
+        explicit AsyncFileIO(IFileSystemDriver* driver, const uint16_t stackSize = ASYNC_FILE_IO_DEFAULT_STACK_SIZE,
+            const uint8_t priority = kTaskDefaultPriority);
+        /// waits until queued operations are done
+        ~AsyncFileIO();
+        AsyncFileIO(const AsyncFileIO&) = delete;
+        AsyncFileIO& operator=(const AsyncFileIO&) = delete;
+
+        void write(const std::string& content, const std::string& filename, done_t done);
+        void append(const std::string& content, const std::string& filename, done_t done);
+        void remove(const std::string& filename, done_t done);
+        void read(const std::string& filename, readDone_t done);
+
+        std::future<bool> write(const std::string& content, const std::string& filename);
+        std::future<bool> append(const std::string& content, const std::string& filename);
+        std::future<bool> remove(const std::string& filename);
+        std::future<std::pair<bool, std::string>> read(const std::string& filename);
+
+        /// any other operation, ordered with operations on filename
+        void submit(const std::string& filename, work_t work, const bool readOnly = false);
+
+        size_t pending() const;
+        void run(void* args) override;
+    private:
+        struct job_t {
+            std::string filename;
+            bool readOnly;
+            work_t work;
+            /// only for appends, allows merging
+            bool isAppend;
+            std::string content;
+            std::vector<done_t> appendDone;
+        };
+
+        void enqueue(job_t&& job);
+        bool takeNext(job_t& job);
+        void execute(job_t& job);
+
+        IFileSystemDriver* _driver;
+        std::list<job_t> _jobs;
+        bool _busy{false};
+        SemaphoreHandle_t _wakeUp;
+        mutable Mutex _mutex;
+};
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "FileSystemDriverDecorator.hpp"
+#include "mutex.hpp"
+#include <list>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+#define CACHING_DRIVER_DEFAULT_BUDGET           (8192)
+#define CACHING_DRIVER_DEFAULT_MAX_ENTRY_SIZE   (2048)
+
+struct cacheStats_t {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    size_t bytesCached;
+};
+
+/// byte budgeted LRU cache of whole small files, keeps digests computed from cached content
+/// entries are invalidated by writes, appends, renames and deletes made through this driver only
+class CachingDriver : public FileSystemDriverDecorator {
+    public:
+        explicit CachingDriver(IFileSystemDriver* driver, const size_t budget = CACHING_DRIVER_DEFAULT_BUDGET,
+            const size_t maxEntrySize = CACHING_DRIVER_DEFAULT_MAX_ENTRY_SIZE);
+
+        cacheStats_t stats() const;
+        /// for changes made bypassing this driver
+        void invalidate(std::string_view filename) const;
+        void invalidateAll() const;
+
+        bool writeContentToFile (std::string_view content, std::string_view filename) const override;
+        bool format() const override;
+        bool deleteFile(std::string_view fullFileName) const override;
+        bool writeMany(const fileContents_t& files) const override;
+        bool deleteMany(const std::vector<std::string>& filenames) const override;
+        bool renameFile(std::string_view from, std::string_view to) const override;
+        bool readEntireFileToString (std::string_view filename, std::string& output) const override;
+        bool readFileToBuffer(std::string_view filename, std::span<char> buffer, size_t& length) const override;
+        bool appendContentToFile (std::string_view content, std::string_view filename) const override;
+        bool doesFileExist(std::string_view filename) const override;
+        bool getFileSize(std::string_view filename, size_t& size) const override;
+        std::string getFileMd5(std::string_view filename) const override;
+        std::string getFileDigest(std::string_view filename, const eDigestType type) const override;
+        bool isContentVerified(std::string_view filename, const std::string& digest) const override;
+        void setContentVerified(std::string_view filename, const std::string& digest) const override;
+        fileReader_t openForReading(std::string_view filename) const override;
+        fileWriter_t openForWriting(std::string_view filename, const eWriteMode mode = eWriteMode::WRITE_TRUNCATE) const override;
+    private:
+        using content_t = std::shared_ptr<const std::string>;
+        struct cacheEntry_t {
+            content_t content;
+            std::list<std::string>::iterator lruPosition;
+            std::map<eDigestType, std::string> digests;
+            std::string verifiedDigest;
+        };
+
+        /// returns cached content, loads it when small enough, otherwise hands out opened reader
+        content_t fetch(std::string_view filename, fileReader_t& uncached) const;
+        void insert(std::string_view filename, content_t content) const;
+        void drop(std::string_view filename) const;
+        void dropAll() const;
+
+        const size_t _budget;
+        const size_t _maxEntrySize;
+        /// hashes std::string and std::string_view alike, lookups by view don't build a key
+        struct keyHash_t {
+            using is_transparent = void;
+            size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+        };
+        mutable std::unordered_map<std::string, cacheEntry_t, keyHash_t, std::equal_to<>> _entries;
+        mutable std::list<std::string> _lru;
+        mutable cacheStats_t _stats{};
+        mutable Mutex _mutex;
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "FileSystemDriverDecorator.hpp"
+#include "LzCodec.hpp"
+#include "mutex.hpp"
+
+#define COMPRESSING_DRIVER_BLOCK_SIZE   (4096)
+
+enum class eCodec : uint8_t {
+    CODEC_NONE,
+    CODEC_LZ
+};
+
+struct compressionStats_t {
+    uint64_t rawBytes;
+    uint64_t storedBytes;
+    uint64_t compressUs;
+    uint64_t decompressUs;
+};
+
+/// stores files as [magic, version, codec, header crc] followed by independently compressed blocks of up to block size
+/// append adds blocks, so small appends compress poorly; put WriteBehindDriver on top to coalesce them
+/// files without valid header are read as plain, sizes and digests refer to uncompressed content
+/// readers decode block by block, whole file is never held in RAM
+/// plain file is migrated through a temp file and rename before the first append
+/// WRITE_OVERWRITE can't be served without rewriting the stored file in place, so it is refused and
+/// SafeFileManipulator framed appends fall back to saving the whole file through its temp file
+class CompressingDriver : public FileSystemDriverDecorator {
+    public:
+        explicit CompressingDriver(IFileSystemDriver* driver, const eCodec codec = eCodec::CODEC_LZ);
+
+        compressionStats_t stats() const;
+        /// uncompressed to stored bytes
+        float compressionRatio() const;
+
+        bool writeContentToFile (std::string_view content, std::string_view filename) const override;
+        bool appendContentToFile (std::string_view content, std::string_view filename) const override;
+        bool writeMany(const fileContents_t& files) const override;
+        bool readEntireFileToString (std::string_view filename, std::string& output) const override;
+        bool readFileToBuffer(std::string_view filename, std::span<char> buffer, size_t& length) const override;
+        bool getFileSize(std::string_view filename, size_t& size) const override;
+        std::string getFileMd5(std::string_view filename) const override;
+        std::string getFileDigest(std::string_view filename, const eDigestType type) const override;
+        fileReader_t openForReading(std::string_view filename) const override;
+        fileWriter_t openForWriting(std::string_view filename, const eWriteMode mode = eWriteMode::WRITE_TRUNCATE) const override;
+
+        /// used by writers, appends encoded blocks of content to output
+        void encode(std::string_view content, std::string& output) const;
+        void encodeHeader(std::string& output) const;
+        /// used by readers, output size must be the raw block length
+        bool decodeBlock(std::span<const char> stored, std::span<char> output) const;
+    private:
+        bool migrateToCompressed(std::string_view filename) const;
+        /// feeds decoded content to consume in chunks, false if file is missing, corrupted or consume refused a chunk
+        template <typename Consumer>
+        bool readDecoded(std::string_view filename, Consumer&& consume) const;
+
+        const eCodec _codec;
+        mutable LzCodec _lz;
+        mutable compressionStats_t _stats{};
+        mutable Mutex _mutex;
+};
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <span>
+#include <stdint.h>
+#include "mbedtls/md5.h"
+#include "IFileStream.hpp"
+
+enum class eDigestType {
+    DIGEST_MD5,
+    DIGEST_CRC32,
+    DIGEST_XXHASH32,
+};
+
+struct xxh32State {
+    uint32_t totalLength;
+    uint32_t acc[4];
+    uint8_t buffer[16];
+    uint32_t bufferedBytes;
+};
+
+/// incremental digest, no heap usage while hashing
+class Digest {
+    public:
+        explicit Digest(const eDigestType type);
+        ~Digest();
+        Digest(const Digest&) = delete;
+        Digest& operator=(const Digest&) = delete;
+
+        void update(std::span<const char> data);
+        /// feeds all remaining reader content in FILE_STREAM_DEFAULT_CHUNK_SIZE blocks
+        bool update(IFileReader& reader);
+        /// feeds next length bytes of reader, for readers which are not at the beginning of the file
+        bool update(IFileReader& reader, size_t length);
+        /// returns lowercase hex string, digest must not be updated afterwards
+        std::string finish();
+        eDigestType type() const { return _type; }
+        /// hex encoded internal state, allows to resume hashing later, must be called before finish()
+        /// prefixed with layout tag, state saved by a build with other layout is refused by restoreState
+        std::string saveState() const;
+        bool restoreState(const std::string& state);
+
+        static std::string ofString(std::string_view content, const eDigestType type);
+    private:
+        size_t stateSize() const;
+        uint32_t stateLayoutTag() const;
+        eDigestType _type;
+        union {
+            mbedtls_md5_context md5;
+            uint32_t crc32;
+            xxh32State xxh32;
+        } _ctx;
+};
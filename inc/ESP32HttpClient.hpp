@@ -4,8 +4,25 @@
 #include <map>
 #include <stdint.h>
 #include <memory>
+#include <vector>
 #include "HttpRequest.hpp"
 
+#define HTTP_CLIENT_DEFAULT_IDLE_TIMEOUT_MS     (30000UL)
+#define HTTP_CLIENT_MAX_CONNECTIONS             (4)
+
+struct httpClientStats_t {
+    uint32_t requests;
+    uint32_t connectionsOpened;
+    uint32_t connectionsReused;
+    uint32_t connectionsDropped;
+    /// requests repeated once on new connection because kept one failed before any response arrived
+    /// GET is repeated on connect, write and header fetch errors, POST only on connect and write errors,
+    /// since after a complete write the server may already have processed it
+    uint32_t staleRetries;
+};
+
+/// requests with keepConnection reuse one initialised handle and socket per scheme, host and port
+/// connection is dropped on error, after idle timeout or when least recently used one is over the limit
 struct ESP32HttpClient {
 
     public:
@@ -14,11 +31,34 @@ struct ESP32HttpClient {
         explicit ESP32HttpClient(const size_t bufferSize, const size_t maxResponseBodyLength);
         bool GET (HttpRequest& req);
         bool POST (HttpRequest& req);
+        /// drops open connections, they were set up with previous certificate
         void setCertificate(const char* const cert, const size_t length);
+        void setIdleTimeout(const uint32_t idleTimeoutMs) { _idleTimeoutMs = idleTimeoutMs; }
+        void closeIdleConnections();
+        void closeAllConnections();
+        httpClientStats_t stats() const { return _stats; }
     private:
+        struct connection_t {
+            esp_http_client_handle_t handle;
+            /// credentials are part of init config, other ones need new handle
+            std::string credentials;
+            std::vector<std::string> headers;
+            uint32_t lastUsedMs;
+            /// post field of last request stays in the handle
+            bool hasBody;
+        };
+
         bool performRequest(HttpRequest& req, const esp_http_client_method_t method);
+        esp_err_t perform(HttpRequest& req, const esp_http_client_method_t method);
+        bool applyBody(HttpRequest& req);
         void resetClient();
         bool initClient(HttpRequest& reqInfo);
+        bool reuseClient(HttpRequest& req, connection_t& connection);
+        void applyHeaders(HttpRequest& req, std::vector<std::string>* previous);
+        void releaseClient(const bool failed);
+        void dropConnection(const std::string& key);
+        static std::string connectionKey(const HttpRequest& req);
+        static std::string credentialsOf(const HttpRequest& req);
         static esp_err_t httpClientEventHandler(esp_http_client_event_t *evt);
         const char* reqStatusString(const eRequestStatus val) const;
         esp_http_client_handle_t _client;
@@ -26,4 +66,11 @@ struct ESP32HttpClient {
         size_t _maxResponseBodyLength;
         const char* _cert{nullptr};
         size_t _certLength{};
+        uint32_t _idleTimeoutMs{HTTP_CLIENT_DEFAULT_IDLE_TIMEOUT_MS};
+        std::map<std::string, connection_t> _connections;
+        /// key of connection _client belongs to, empty for one-off client
+        std::string _clientKey;
+        /// _client is a kept connection used before, its socket may have been closed by server meanwhile
+        bool _clientReused{false};
+        httpClientStats_t _stats{};
 };
\ No newline at end of file
@@ -1,11 +1,19 @@
 #pragma once
 
 #include <stdint.h>
+#include <functional>
 #include "esp_system.h"
 
 namespace ESP32Utils {
+    using rebootHook_t = std::function<void()>;
+
     void reboot();
     uint32_t chipID();
     esp_reset_reason_t rebootReason();
     uint32_t millis();
+    /// hook runs before esp_restart, whoever calls it; returns id for removeRebootHook
+    /// hooks must not add or remove hooks
+    uint32_t addRebootHook(rebootHook_t hook);
+    /// waits for the hook if it is running, it is never called after return
+    void removeRebootHook(const uint32_t id);
 };
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <stdint.h>
+#include "Digest.hpp"
+#include "IFileStream.hpp"
+#include "mutex.hpp"
+
+/// thread safe in-RAM mirror of file names, sizes and digests
+/// keys are full paths, directories are prefixes as in SPIFFS flat namespace
+class FileIndex {
+    public:
+        static constexpr size_t kUnknownSize {SIZE_MAX};
+
+        void clear();
+        /// entries modified after this call get a greater generation
+        uint32_t currentGeneration() const;
+        /// swaps in index built by directory scan started at scanStart, queries never see it half built
+        /// entries changed through the driver meanwhile are kept, entries removed meanwhile don't come back
+        void replaceWith(FileIndex&& scanned, const uint32_t scanStart);
+        /// adds file or marks it modified, cached digest is dropped
+        void update(std::string_view filename, const size_t size = kUnknownSize);
+        /// adds written bytes to the known size, new entry is created with appended size
+        void grow(std::string_view filename, const size_t bytesAppended);
+        /// stores size read from the filesystem, content is unchanged so cached digest stays valid
+        void resolveSize(std::string_view filename, const size_t size);
+        void remove(std::string_view filename);
+        void rename(std::string_view from, std::string_view to);
+
+        bool contains(std::string_view filename) const;
+        bool size(std::string_view filename, size_t& size) const;
+        /// generation changes on every modification, allows to drop results computed from stale content
+        uint32_t generation(std::string_view filename) const;
+        bool digest(std::string_view filename, const eDigestType type, std::string& digest) const;
+        void setDigest(std::string_view filename, const eDigestType type, const std::string& digest, const uint32_t generation);
+
+        uint32_t count(const std::string& path) const;
+        /// names are read from the index one at a time, safe to modify files while iterating
+        /// files added meanwhile may or may not be listed, reader must not outlive the index
+        directoryReader_t openDirectory(const std::string& path) const;
+    private:
+        struct IndexDirectoryReader;
+        struct fileMeta_t {
+            size_t size;
+            uint32_t generation;
+            eDigestType digestType;
+            std::string digest;
+        };
+        /// existing entry or a new empty one, caller holds the lock
+        fileMeta_t& entry(std::string_view filename);
+        static std::string directoryPrefix(const std::string& path);
+        template<typename visitor_t>
+        void forEachInDirectory(const std::string& path, visitor_t visitor) const;
+        // transparent comparator, lookups by view don't build a key string
+        std::map<std::string, fileMeta_t, std::less<>> _files;
+        uint32_t _generation{};
+        uint32_t _lastRemoval{};
+        mutable Mutex _mutex;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string_view>
+#include <initializer_list>
+#include <string.h>
+
+/// SPIFFS object names are limited to CONFIG_SPIFFS_OBJ_NAME_LEN (32 by default), mount point comes on top
+#define FILE_PATH_MAX_LENGTH        64
+
+/// printf arguments of a string_view path, views are not NUL terminated
+#define PATH_FMT                    "%.*s"
+#define PATH_ARG(path)              static_cast<int>((path).length()), (path).data()
+
+/// NUL terminated path in a fixed buffer, building it never allocates
+/// path which doesn't fit is left empty, so the operation fails instead of touching a truncated name
+class FilePath {
+    public:
+        FilePath(std::initializer_list<std::string_view> parts) {
+            for (const auto& part : parts) {
+                if (_length + part.length() >= sizeof(_path)) {
+                    _length = 0;
+                    break;
+                }
+                memcpy(_path + _length, part.data(), part.length());
+                _length += part.length();
+            }
+            _path[_length] = '\0';
+        }
+        explicit FilePath(const std::string_view path) : FilePath({path}) {}
+
+        const char* c_str() const { return _path; }
+        size_t length() const { return _length; }
+        bool empty() const { return 0 == _length; }
+        operator std::string_view() const { return {_path, _length}; }
+    private:
+        char _path[FILE_PATH_MAX_LENGTH];
+        size_t _length{0};
+};
\ No newline at end of file
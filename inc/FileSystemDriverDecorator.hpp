@@ -0,0 +1,95 @@
+#pragma once
+
+#include "IFileSystemDriver.hpp"
+#include <assert.h>
+
+/// forwards every call to wrapped driver, takes ownership of it
+class FileSystemDriverDecorator : public IFileSystemDriver {
+    protected:
+        IFileSystemDriver* _driver;
+    public:
+        explicit FileSystemDriverDecorator(IFileSystemDriver* driver)
+                        : _driver(driver) {
+            assert(NULL != driver);
+        }
+
+        ~FileSystemDriverDecorator() override {
+            delete _driver;
+        }
+
+        FileSystemDriverDecorator(const FileSystemDriverDecorator&) = delete;
+        FileSystemDriverDecorator& operator=(const FileSystemDriverDecorator&) = delete;
+
+        bool writeContentToFile (std::string_view content, std::string_view filename) const override {
+            return _driver->writeContentToFile(content, filename);
+        }
+        float usagePercent() const override {
+            return _driver->usagePercent();
+        }
+        bool isReady() const override {
+            return _driver->isReady();
+        }
+        bool format() const override {
+            return _driver->format();
+        }
+        void initialize() override {
+            _driver->initialize();
+        }
+        bool deleteFile(std::string_view fullFileName) const override {
+            return _driver->deleteFile(fullFileName);
+        }
+        bool renameFile(std::string_view from, std::string_view to) const override {
+            return _driver->renameFile(from, to);
+        }
+        std::vector<std::string> filesList(const std::string& path) const override {
+            return _driver->filesList(path);
+        }
+        uint32_t countFiles (const std::string& path) const override {
+            return _driver->countFiles(path);
+        }
+        bool readEntireFileToString (std::string_view filename, std::string& output) const override {
+            return _driver->readEntireFileToString(filename, output);
+        }
+        bool readFileToBuffer(std::string_view filename, std::span<char> buffer, size_t& length) const override {
+            return _driver->readFileToBuffer(filename, buffer, length);
+        }
+        bool appendContentToFile (std::string_view content, std::string_view filename) const override {
+            return _driver->appendContentToFile(content, filename);
+        }
+        bool doesFileExist(std::string_view filename) const override {
+            return _driver->doesFileExist(filename);
+        }
+        bool writeMany(const fileContents_t& files) const override {
+            return _driver->writeMany(files);
+        }
+        bool deleteMany(const std::vector<std::string>& filenames) const override {
+            return _driver->deleteMany(filenames);
+        }
+        std::vector<bool> existsMany(const std::vector<std::string>& filenames) const override {
+            return _driver->existsMany(filenames);
+        }
+        bool getFileSize(std::string_view filename, size_t& size) const override {
+            return _driver->getFileSize(filename, size);
+        }
+        std::string getFileMd5(std::string_view filename) const override {
+            return _driver->getFileMd5(filename);
+        }
+        std::string getFileDigest(std::string_view filename, const eDigestType type) const override {
+            return _driver->getFileDigest(filename, type);
+        }
+        bool isContentVerified(std::string_view filename, const std::string& digest) const override {
+            return _driver->isContentVerified(filename, digest);
+        }
+        void setContentVerified(std::string_view filename, const std::string& digest) const override {
+            _driver->setContentVerified(filename, digest);
+        }
+        fileReader_t openForReading(std::string_view filename) const override {
+            return _driver->openForReading(filename);
+        }
+        fileWriter_t openForWriting(std::string_view filename, const eWriteMode mode = eWriteMode::WRITE_TRUNCATE) const override {
+            return _driver->openForWriting(filename, mode);
+        }
+        directoryReader_t openDirectory(const std::string& path) const override {
+            return _driver->openDirectory(path);
+        }
+};
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "sdkconfig.h"
+#include "LatencyHistogram.hpp"
+#include "mutex.hpp"
+#include <stdint.h>
+
+#define FS_STATS_DEFAULT_RATED_ERASE_CYCLES (100000)
+
+/// one operation per opened stream, bytes and latency from open to close
+enum class eFsOperation {
+    FS_OP_WRITE,
+    FS_OP_APPEND,
+    FS_OP_READ,
+    /// whole getFileDigest call, its reads are counted under FS_OP_READ too
+    FS_OP_DIGEST,
+    FS_OP_COUNT
+};
+
+struct fsOperationStats_t {
+    uint32_t calls;
+    uint32_t failures;
+    uint64_t bytes;
+    LatencyHistogram latency;
+};
+
+struct fsStats_t {
+    fsOperationStats_t operations[static_cast<size_t>(eFsOperation::FS_OP_COUNT)];
+    /// since construction or last reset
+    uint32_t periodMs;
+
+    const fsOperationStats_t& operator[](const eFsOperation op) const { return operations[static_cast<size_t>(op)]; }
+};
+
+struct flashWearEstimate_t {
+    uint64_t bytesWritten;
+    size_t partitionBytes;
+    /// average erase cycles per block, assumes writes are spread over whole partition
+    float eraseCycles;
+    float budgetUsedPercent;
+    uint64_t bytesPerDay;
+    /// at current write rate, 0 if nothing was written yet
+    uint32_t daysLeft;
+};
+
+/// thread safe counters, filled by AbstractFileSystemDriver streams and FS_STATS_* macros
+class FileSystemStats {
+    public:
+        FileSystemStats();
+        void record(const eFsOperation op, const uint64_t bytes, const uint32_t us, const bool ok);
+        fsStats_t snapshot() const;
+        void reset();
+        flashWearEstimate_t wearEstimate(const size_t partitionBytes, const uint32_t ratedEraseCycles) const;
+    private:
+        fsStats_t _stats{};
+        uint64_t _bytesWritten{};
+        uint32_t _startMs{};
+        mutable Mutex _mutex;
+};
+
+#if CONFIG_ENABLE_FS_DRIVER_STATS
+#include "esp_timer.h"
+#define FS_STATS_BEGIN()                const int64_t fsStatsStartUs {esp_timer_get_time()}
+#define FS_STATS_END(op, bytes, ok)     _fsStats.record((op), (bytes), static_cast<uint32_t>(esp_timer_get_time() - fsStatsStartUs), (ok))
+#else
+#define FS_STATS_BEGIN()
+#define FS_STATS_END(op, bytes, ok)
+#endif
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <stddef.h>
+
+#define FILE_STREAM_DEFAULT_CHUNK_SIZE      512
+
+enum class eWriteMode {
+    WRITE_TRUNCATE,
+    WRITE_APPEND,
+    WRITE_OVERWRITE,    // keeps existing content, writes from the beginning of the file
+};
+
+struct IFileReader {
+    virtual ~IFileReader() = default;
+    /// reads up to buffer.size() bytes, returns number of bytes read, 0 on EOF or error
+    virtual size_t read(std::span<char> buffer) = 0;
+    virtual size_t size() const = 0;
+};
+
+struct IFileWriter {
+    virtual ~IFileWriter() = default;
+    /// returns number of bytes written, less than data.size() on error
+    virtual size_t write(std::span<const char> data) = 0;
+    /// pushes written data down to the storage
+    virtual bool sync() = 0;
+    /// flushes and closes underlying file, writer is unusable afterwards
+    virtual bool close() = 0;
+};
+
+struct IDirectoryReader {
+    virtual ~IDirectoryReader() = default;
+    /// returns name of the next regular file, nullptr when directory is exhausted
+    /// pointer stays valid until the next call
+    virtual const char* next() = 0;
+};
+
+using fileReader_t = std::unique_ptr<IFileReader>;
+using fileWriter_t = std::unique_ptr<IFileWriter>;
+using directoryReader_t = std::unique_ptr<IDirectoryReader>;
@@ -1,22 +1,54 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include "IFileStream.hpp"
+#include "Digest.hpp"
+#include "FilePath.hpp"
+
+/// pairs of filename and content
+using fileContents_t = std::vector<std::pair<std::string, std::string>>;
+
+/// filenames are views, drivers don't keep them past the call and build NUL terminated copies on stack
 class IFileSystemDriver {
 
     public:
         virtual ~IFileSystemDriver() = default;
-        virtual bool writeContentToFile (const std::string& content, const std::string& filename) const = 0;
+        virtual bool writeContentToFile (std::string_view content, std::string_view filename) const = 0;
         virtual float usagePercent() const = 0;
         virtual bool isReady() const = 0;
         virtual bool format() const = 0;
         virtual void initialize() = 0;
 
-        virtual bool deleteFile(const std::string& fullFileName) const = 0;
+        virtual bool deleteFile(std::string_view fullFileName) const = 0;
+        /// replaces destination file if it exists, replacement is atomic only where the filesystem provides it,
+        /// SPIFFS may be left with source file only after power loss
+        virtual bool renameFile(std::string_view from, std::string_view to) const = 0;
         virtual std::vector<std::string> filesList(const std::string& path) const = 0;
         virtual uint32_t countFiles (const std::string& path) const = 0;
-        virtual bool readEntireFileToString (const std::string& filename, std::string& output) const = 0;
-        virtual bool appendContentToFile (const std::string& content, const std::string& filename) const = 0;
-        virtual bool doesFileExist(const std::string& filename) const = 0;
-        virtual std::string getFileMd5(const std::string& filename) const = 0;
+        virtual bool readEntireFileToString (std::string_view filename, std::string& output) const = 0;
+        /// reads whole file into caller's buffer without allocation, fails if file doesn't fit
+        virtual bool readFileToBuffer(std::string_view filename, std::span<char> buffer, size_t& length) const = 0;
+        virtual bool appendContentToFile (std::string_view content, std::string_view filename) const = 0;
+        virtual bool doesFileExist(std::string_view filename) const = 0;
+        /// batch operations share lookups, true only if every file succeeded
+        virtual bool writeMany(const fileContents_t& files) const = 0;
+        /// missing files count as deleted
+        virtual bool deleteMany(const std::vector<std::string>& filenames) const = 0;
+        /// result is in order of filenames
+        virtual std::vector<bool> existsMany(const std::vector<std::string>& filenames) const = 0;
+        virtual bool getFileSize(std::string_view filename, size_t& size) const = 0;
+        virtual std::string getFileMd5(std::string_view filename) const = 0;
+        /// returns empty string if file can't be read
+        virtual std::string getFileDigest(std::string_view filename, const eDigestType type) const = 0;
+        /// caching drivers remember digest verified by caller until the file is modified, others return false
+        virtual bool isContentVerified(std::string_view filename, const std::string& digest) const = 0;
+        virtual void setContentVerified(std::string_view filename, const std::string& digest) const = 0;
+
+        /// returns nullptr if file can't be opened
+        virtual fileReader_t openForReading(std::string_view filename) const = 0;
+        virtual fileWriter_t openForWriting(std::string_view filename, const eWriteMode mode = eWriteMode::WRITE_TRUNCATE) const = 0;
+        /// lazily iterates regular files of the directory, returns nullptr if directory can't be opened
+        virtual directoryReader_t openDirectory(const std::string& path) const = 0;
 };
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LATENCY_HISTOGRAM_BUCKETS   (32)
+
+struct latencySummary_t {
+    uint32_t count;
+    uint32_t p50Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+};
+
+/// fixed size histogram with power of two buckets, percentiles are reported as bucket upper bound
+/// not thread safe, owner synchronizes
+class LatencyHistogram {
+    public:
+        void record(const uint32_t us);
+        void reset();
+        uint32_t count() const { return _count; }
+        uint32_t max() const { return _max; }
+        /// percent in 0..100
+        uint32_t percentile(const float percent) const;
+        latencySummary_t summary() const;
+        /// bucket i counts values in [2^(i-1), 2^i), bucket 0 counts zeros
+        const uint32_t* buckets() const { return _buckets; }
+    private:
+        uint32_t _buckets[LATENCY_HISTOGRAM_BUCKETS] {};
+        uint32_t _count{};
+        uint32_t _max{};
+};
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#if CONFIG_ENABLE_LITTLEFS_DRIVER
+#include "AbstractFileSystemDriver.hpp"
+#include "esp_littlefs.h"
+
+#define LITTLEFS_IDF_DEFAULT_PATH           "/littlefs"
+#define LITTLEFS_IDF_DEFAULT_PARTITION      "littlefs"
+
+/// drop-in alternative to SPIFFS_IDFDriver, directories are real so they are created on write
+/// runs on a flash partition only, RAM block device and SPIFFS comparison benchmark are open in TODO.md
+struct LittleFS_IDFDriver : AbstractFileSystemDriver {
+    explicit LittleFS_IDFDriver(const char* const path = LITTLEFS_IDF_DEFAULT_PATH,
+        const char* const partitionLabel = LITTLEFS_IDF_DEFAULT_PARTITION);
+    ~LittleFS_IDFDriver();
+    bool deleteFile(std::string_view fullFileName) const override;
+    bool renameFile(std::string_view from, std::string_view to) const override;
+    bool doesFileExist(std::string_view filename) const override;
+    bool deleteMany(const std::vector<std::string>& filenames) const override;
+    /// stat is a cheap directory lookup here, cheaper than listing
+    std::vector<bool> existsMany(const std::vector<std::string>& filenames) const override;
+    bool getFileSize(std::string_view filename, size_t& size) const override;
+    float usagePercent() const override;
+    size_t totalBytes() const override;
+    bool format() const override;
+    void initialize() override;
+    directoryReader_t openDirectory(const std::string& path) const override;
+protected:
+    fileReader_t doOpenForReading(std::string_view filename) const override;
+    fileWriter_t doOpenForWriting(std::string_view filename, const eWriteMode mode) const override;
+private:
+    esp_vfs_littlefs_conf_t _conf{};
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <span>
+#include <stdint.h>
+#include <stddef.h>
+
+#define LZ_CODEC_HASH_LOG   (10)
+
+/// LZ4 block format codec, window is limited by block size, block must be below 64 KiB
+/// compressor keeps its hash table inside the object, so it is not reentrant
+class LzCodec {
+    public:
+        /// returns compressed size or 0 if output doesn't fit into dst
+        size_t compress(std::span<const char> src, std::span<char> dst);
+        /// dst size must be the exact decompressed size
+        static bool decompress(std::span<const char> src, std::span<char> dst);
+    private:
+        uint16_t _table[1 << LZ_CODEC_HASH_LOG];
+};
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include <esp_system.h>
 #include <nvs_flash.h>
 
+#include "NVSSession.hpp"
+
 using namespace std;
 
 class NVS{
@@ -18,6 +20,31 @@ class NVS{
         bool write(const char* const storage, const char* const tag, const char* val);
 
         bool erase(const char* const storage, const char* const tag);
+
+        /// typed access without heap allocation, each call opens its own session
+        template<typename T> requires (is_integral_v<T> and false == is_same_v<T, bool>)
+        bool readValue(const char* const storage, const char* const tag, T& res) {
+            return NVSSession{storage, true}.readValue(tag, res);
+        }
+        template<typename T> requires (is_integral_v<T> and false == is_same_v<T, bool>)
+        bool writeValue(const char* const storage, const char* const tag, const T val) {
+            NVSSession session {storage};
+            return session.writeValue(tag, val) and session.commit();
+        }
+        bool read(const char* const storage, const char* const tag, span<char> buffer, size_t& length);
+        bool readBlob(const char* const storage, const char* const tag, span<uint8_t> buffer, size_t& length);
+        bool writeBlob(const char* const storage, const char* const tag, span<const uint8_t> data);
+        template<typename T> requires (is_trivially_copyable_v<T> and false == is_integral_v<T>
+            and false == is_pointer_v<T> and false == ranges::contiguous_range<T>)
+        bool readBlob(const char* const storage, const char* const tag, T& res) {
+            return NVSSession{storage, true}.readBlob(tag, res);
+        }
+        template<typename T> requires (is_trivially_copyable_v<T> and false == is_integral_v<T>
+            and false == is_pointer_v<T> and false == ranges::contiguous_range<T>)
+        bool writeBlob(const char* const storage, const char* const tag, const T& val) {
+            NVSSession session {storage};
+            return session.writeBlob(tag, val) and session.commit();
+        }
     private:
         bool openToRead(const char* const storage);
         bool openToWrite(const char* const storage);
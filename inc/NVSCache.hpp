@@ -0,0 +1,75 @@
+#pragma once
+
+#include "mutex.hpp"
+#include <map>
+#include <string>
+#include <variant>
+#include <stdint.h>
+
+#define NVS_CACHE_DEFAULT_FLUSH_PERIOD_MS       (60000)
+#define NVS_CACHE_DEFAULT_MAX_DIRTY_CHANGES     (32)
+
+struct nvsCacheConfig_t {
+    /// dirty values older than this are committed
+    uint32_t flushPeriodMs {NVS_CACHE_DEFAULT_FLUSH_PERIOD_MS};
+    /// changes since last flush which force one
+    uint32_t maxDirtyChanges {NVS_CACHE_DEFAULT_MAX_DIRTY_CHANGES};
+};
+
+struct nvsCacheStats_t {
+    uint32_t writes;
+    uint32_t readHits;
+    uint32_t readMisses;
+    uint32_t flushes;
+    uint32_t commits;
+    /// commits a write-through NVS would have done on top of ours: unchanged writes and changes coalesced by a flush
+    uint32_t commitsSaved;
+};
+
+/// RAM mirror of NVS values for keys which change often, reads are served from memory
+/// changes are lost on power loss until flushed, flush happens on period, change count, destruction and before reboot
+/// period is checked on every call and by flushExpired(), which should be called periodically by the owner
+class NVSCache {
+    public:
+        explicit NVSCache(const nvsCacheConfig_t& config = nvsCacheConfig_t{});
+        ~NVSCache();
+        NVSCache(const NVSCache&) = delete;
+        NVSCache& operator=(const NVSCache&) = delete;
+
+        bool read(const char* const storage, const char* const tag, std::string& res);
+        bool read(const char* const storage, const char* const tag, int64_t& res);
+
+        bool write(const char* const storage, const char* const tag, const int64_t val);
+        bool write(const char* const storage, const char* const tag, const char* val);
+
+        bool erase(const char* const storage, const char* const tag);
+
+        bool flush();
+        bool flushExpired();
+        nvsCacheStats_t stats() const;
+    private:
+        using value_t = std::variant<std::monostate, int64_t, std::string>;
+        struct entry_t {
+            /// monostate for erased or missing key
+            value_t value;
+            bool dirty;
+            /// with monostate value, types read and found missing; NVS keys are typed, so other types may exist
+            uint8_t missingTypes;
+        };
+        using entries_t = std::map<std::string, entry_t>;
+
+        template<typename T>
+        bool doRead(const char* const storage, const char* const tag, T& res);
+        bool update(const char* const storage, const char* const tag, value_t&& value);
+        entry_t* find(const char* const storage, const char* const tag);
+        bool flushAll();
+        bool flushIfNeeded();
+
+        const nvsCacheConfig_t _config;
+        std::map<std::string, entries_t> _storages;
+        uint32_t _dirtyChanges{};
+        uint32_t _firstDirtyMs{};
+        nvsCacheStats_t _stats{};
+        mutable Mutex _mutex;
+        uint32_t _rebootHookId{};
+};
\ No newline at end of file
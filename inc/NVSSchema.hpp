@@ -0,0 +1,153 @@
+#pragma once
+
+#include "NVSSession.hpp"
+#include <algorithm>
+#include <tuple>
+#include <span>
+#include <type_traits>
+
+/// nvs limit for namespace and key names, terminating zero excluded
+#define NVS_SCHEMA_MAX_NAME_LENGTH  (15)
+
+namespace NVSSchemaDetails {
+    consteval size_t nameLength(const char* const name) {
+        size_t length {0};
+        while (name[length]) {
+            ++length;
+        }
+        return length;
+    }
+
+    consteval bool sameName(const char* const left, const char* const right) {
+        size_t i {0};
+        for (; left[i] and left[i] == right[i]; ++i) {}
+        return left[i] == right[i];
+    }
+
+    // not constexpr, reaching one of these during constant evaluation is a compile error naming the problem
+    inline void invalidNvsNameIsEmpty() {}
+    inline void invalidNvsNameIsLongerThan15Characters() {}
+    inline void invalidNvsKeyIsDeclaredTwice() {}
+
+    consteval void validateName(const char* const name) {
+        if (nullptr == name or 0 == nameLength(name)) {
+            invalidNvsNameIsEmpty();
+        }
+        if (nameLength(name) > NVS_SCHEMA_MAX_NAME_LENGTH) {
+            invalidNvsNameIsLongerThan15Characters();
+        }
+    }
+
+    template<typename T>
+    constexpr bool isString {std::is_array_v<T> and std::is_same_v<std::remove_extent_t<T>, char>};
+
+    template<typename T>
+    bool load(const NVSSession& session, const char* const name, T& value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            uint8_t raw {};
+            if (false == session.readValue(name, raw)) {
+                return false;
+            }
+            value = raw;
+            return true;
+        }
+        else if constexpr (std::is_integral_v<T>) {
+            return session.readValue(name, value);
+        }
+        else if constexpr (isString<T>) {
+            size_t length {0};
+            return session.read(name, std::span<char>(value), length);
+        }
+        else {
+            static_assert(std::is_trivially_copyable_v<T>, "NVS field should be integer, char array or trivially copyable");
+            return session.readBlob(name, value);
+        }
+    }
+
+    template<typename T>
+    bool save(NVSSession& session, const char* const name, const T& value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            return session.writeValue(name, static_cast<uint8_t>(value));
+        }
+        else if constexpr (std::is_integral_v<T>) {
+            return session.writeValue(name, value);
+        }
+        else if constexpr (isString<T>) {
+            // array may be filled up to the last byte without terminating zero, cut so it fits back on load
+            char terminated[std::extent_v<T>] {};
+            std::copy_n(value, std::extent_v<T> - 1, terminated);
+            return session.write(name, terminated);
+        }
+        else {
+            static_assert(std::is_trivially_copyable_v<T>, "NVS field should be integer, char array or trivially copyable");
+            return session.writeBlob(name, value);
+        }
+    }
+};
+
+/// one key of a settings struct, type and max length come from the member, default from its initializer
+template<typename Settings, typename T>
+struct nvsField_t {
+    consteval nvsField_t(const char* const fieldName, T Settings::* const fieldMember)
+        :   name{fieldName}, member{fieldMember} {
+        NVSSchemaDetails::validateName(fieldName);
+    }
+    const char* name;
+    T Settings::* member;
+};
+
+/// keys of one namespace, validated at compile time, declare as static constexpr
+/// loadAll and saveAll use one session, so the namespace is opened and committed once
+template<typename Settings, typename... Fields>
+class NVSSchema {
+    public:
+        consteval NVSSchema(const char* const storage, const Fields... fields)
+            :   _storage{storage}, _fields{fields...} {
+            NVSSchemaDetails::validateName(storage);
+            const char* const names[] {fields.name...};
+            for (size_t i = 0; i < sizeof...(Fields); ++i) {
+                for (size_t j = i + 1; j < sizeof...(Fields); ++j) {
+                    if (NVSSchemaDetails::sameName(names[i], names[j])) {
+                        NVSSchemaDetails::invalidNvsKeyIsDeclaredTwice();
+                    }
+                }
+            }
+        }
+
+        const char* storage() const { return _storage; }
+        static constexpr size_t size() { return sizeof...(Fields); }
+
+        /// missing keys keep defaults of Settings, false if any key was missing
+        bool loadAll(Settings& settings) const {
+            Settings loaded {};
+            bool ret {false};
+            {
+                const NVSSession session {_storage, true};
+                if (session.isOpen()) {
+                    ret = std::apply([&](const auto&... field) {
+                        return (NVSSchemaDetails::load(session, field.name, loaded.*field.member) & ...);
+                    }, _fields);
+                }
+            }
+            settings = loaded;
+            return ret;
+        }
+
+        /// unchanged values are not rewritten by nvs, commit happens once
+        bool saveAll(const Settings& settings) const {
+            NVSSession session {_storage};
+            if (false == session.isOpen()) {
+                return false;
+            }
+            const bool ret {std::apply([&](const auto&... field) {
+                return (NVSSchemaDetails::save(session, field.name, settings.*field.member) & ...);
+            }, _fields)};
+            return session.commit() and ret;
+        }
+    private:
+        const char* _storage;
+        std::tuple<Fields...> _fields;
+};
+
+template<typename Settings, typename... T>
+NVSSchema(const char* const, const nvsField_t<Settings, T>...) -> NVSSchema<Settings, nvsField_t<Settings, T>...>;
\ No newline at end of file
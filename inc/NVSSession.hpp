@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <span>
+#include <ranges>
+#include <type_traits>
+#include <stdint.h>
+
+#include <nvs.h>
+
+/// keeps one namespace open for many operations and commits once
+/// changes are committed by commit() or on destruction, nvs has no rollback so there is nothing to discard
+class NVSSession {
+    public:
+        explicit NVSSession(const char* const storage, const bool readOnly = false);
+        ~NVSSession();
+        NVSSession(const NVSSession&) = delete;
+        NVSSession& operator=(const NVSSession&) = delete;
+
+        bool isOpen() const { return _isOpen; }
+
+        bool read(const char* const tag, std::string& res) const;
+        bool read(const char* const tag, int64_t& res) const;
+
+        bool write(const char* const tag, const int64_t val);
+        bool write(const char* const tag, const char* val);
+
+        /// any integer width, stored with matching nvs type so widths are not interchangeable
+        /// named apart from read/write so integer literals keep going to the int64 overloads
+        template<typename T> requires (std::is_integral_v<T> and false == std::is_same_v<T, bool>)
+        bool readValue(const char* const tag, T& res) const {
+            return _isOpen and checked(getInteger(_handle, tag, res), tag);
+        }
+        template<typename T> requires (std::is_integral_v<T> and false == std::is_same_v<T, bool>)
+        bool writeValue(const char* const tag, const T val) {
+            return isWritable() and changed(setInteger(_handle, tag, val), tag, "set");
+        }
+
+        /// string into caller buffer including terminating zero, length excludes it
+        bool read(const char* const tag, std::span<char> buffer, size_t& length) const;
+
+        /// fails without reading if buffer is too small, required size is returned in length then
+        bool readBlob(const char* const tag, std::span<uint8_t> buffer, size_t& length) const;
+        bool writeBlob(const char* const tag, std::span<const uint8_t> data);
+
+        /// raw copy of the object, fails if stored size differs, so layout changes are not loaded silently
+        /// pointers and spans/arrays/containers are refused, their bytes go through the span overloads
+        template<typename T> requires (std::is_trivially_copyable_v<T> and false == std::is_integral_v<T>
+            and false == std::is_pointer_v<T> and false == std::ranges::contiguous_range<T>)
+        bool readBlob(const char* const tag, T& res) const {
+            T value;
+            size_t length {0};
+            if (false == readBlob(tag, std::span<uint8_t>(reinterpret_cast<uint8_t*>(&value), sizeof(T)), length)
+                or sizeof(T) != length) {
+                return false;
+            }
+            res = value;
+            return true;
+        }
+        template<typename T> requires (std::is_trivially_copyable_v<T> and false == std::is_integral_v<T>
+            and false == std::is_pointer_v<T> and false == std::ranges::contiguous_range<T>)
+        bool writeBlob(const char* const tag, const T& val) {
+            return writeBlob(tag, std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(&val), sizeof(T)));
+        }
+
+        bool erase(const char* const tag);
+        bool eraseAll();
+
+        /// no-op if nothing was changed since last commit
+        bool commit();
+        /// sets and erases since last commit
+        uint32_t pendingChanges() const { return _pendingChanges; }
+    private:
+        bool isWritable() const { return _isOpen and false == _readOnly; }
+        bool changed(const esp_err_t err, const char* const tag, const char* const operation);
+        bool checked(const esp_err_t err, const char* const tag) const;
+
+        template<typename T>
+        static esp_err_t getInteger(const nvs_handle_t handle, const char* const tag, T& res) {
+            if constexpr (std::is_signed_v<T>) {
+                if constexpr (1 == sizeof(T)) { return nvs_get_i8(handle, tag, reinterpret_cast<int8_t*>(&res)); }
+                else if constexpr (2 == sizeof(T)) { return nvs_get_i16(handle, tag, reinterpret_cast<int16_t*>(&res)); }
+                else if constexpr (4 == sizeof(T)) { return nvs_get_i32(handle, tag, reinterpret_cast<int32_t*>(&res)); }
+                else { return nvs_get_i64(handle, tag, reinterpret_cast<int64_t*>(&res)); }
+            }
+            else {
+                if constexpr (1 == sizeof(T)) { return nvs_get_u8(handle, tag, reinterpret_cast<uint8_t*>(&res)); }
+                else if constexpr (2 == sizeof(T)) { return nvs_get_u16(handle, tag, reinterpret_cast<uint16_t*>(&res)); }
+                else if constexpr (4 == sizeof(T)) { return nvs_get_u32(handle, tag, reinterpret_cast<uint32_t*>(&res)); }
+                else { return nvs_get_u64(handle, tag, reinterpret_cast<uint64_t*>(&res)); }
+            }
+        }
+
+        template<typename T>
+        static esp_err_t setInteger(const nvs_handle_t handle, const char* const tag, const T val) {
+            if constexpr (std::is_signed_v<T>) {
+                if constexpr (1 == sizeof(T)) { return nvs_set_i8(handle, tag, static_cast<int8_t>(val)); }
+                else if constexpr (2 == sizeof(T)) { return nvs_set_i16(handle, tag, static_cast<int16_t>(val)); }
+                else if constexpr (4 == sizeof(T)) { return nvs_set_i32(handle, tag, static_cast<int32_t>(val)); }
+                else { return nvs_set_i64(handle, tag, static_cast<int64_t>(val)); }
+            }
+            else {
+                if constexpr (1 == sizeof(T)) { return nvs_set_u8(handle, tag, static_cast<uint8_t>(val)); }
+                else if constexpr (2 == sizeof(T)) { return nvs_set_u16(handle, tag, static_cast<uint16_t>(val)); }
+                else if constexpr (4 == sizeof(T)) { return nvs_set_u32(handle, tag, static_cast<uint32_t>(val)); }
+                else { return nvs_set_u64(handle, tag, static_cast<uint64_t>(val)); }
+            }
+        }
+
+        nvs_handle_t _handle{};
+        bool _isOpen{false};
+        bool _readOnly;
+        uint32_t _pendingChanges{};
+        /// set once any change failed, reported by commit
+        bool _failed{false};
+};
\ No newline at end of file
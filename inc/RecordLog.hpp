@@ -0,0 +1,78 @@
+#pragma once
+
+#include "IFileSystemDriver.hpp"
+#include "mutex.hpp"
+#include <deque>
+#include <assert.h>
+
+#define RECORD_LOG_DEFAULT_SEGMENT_SIZE     (4096)
+#define RECORD_LOG_DEFAULT_MAX_USAGE        (80.0F)
+
+struct recordLogStats_t {
+    uint32_t appended;
+    uint32_t consumed;
+    uint32_t droppedSegments;
+    uint32_t corruptedSegments;
+};
+
+/// append-only queue of records stored in fixed size segment files <directory>/<sequence>.seg
+/// record is [magic, length, crc32] header followed by payload, first invalid record ends the segment
+/// consumer reads sequentially and commits, fully consumed segments are deleted as a whole
+/// delivery is at-least-once: records read but not committed before reboot are read again
+/// takes ownership of driver
+class RecordLog {
+    public:
+        RecordLog(IFileSystemDriver* driver, const std::string& directory,
+            const size_t segmentSize = RECORD_LOG_DEFAULT_SEGMENT_SIZE, const float maxUsagePercent = RECORD_LOG_DEFAULT_MAX_USAGE);
+        ~RecordLog();
+        RecordLog(const RecordLog&) = delete;
+        RecordLog& operator=(const RecordLog&) = delete;
+
+        /// false if record doesn't fit segment or can't be written
+        bool append(std::string_view record);
+        /// false when there are no more records
+        bool readNext(std::string& record);
+        /// marks records returned by readNext as consumed
+        bool commit();
+        /// next readNext starts from last committed record
+        void rewind();
+
+        bool isEmpty() const;
+        size_t segmentsCount() const;
+        recordLogStats_t stats() const;
+    private:
+        struct position_t {
+            uint32_t segment;
+            size_t offset;
+        };
+
+        void recover();
+        void validateTail();
+        bool nextSegment(const uint32_t segment, uint32_t& next) const;
+        void dropFrontSegment();
+        bool startSegment();
+        void enforceUsageLimit();
+        bool openSegmentForReading(const position_t& position);
+        bool persistCursor() const;
+        std::string segmentName(const uint32_t segment) const;
+        std::string cursorName() const;
+
+        IFileSystemDriver* _driver;
+        const std::string _directory;
+        const size_t _segmentSize;
+        const float _maxUsagePercent;
+
+        std::deque<uint32_t> _segments;
+        uint32_t _nextSegment{};
+        fileWriter_t _tail;
+        size_t _tailSize{};
+        /// tail ends with torn record, new segment is started on next append
+        bool _tailSealed{false};
+
+        fileReader_t _reader;
+        position_t _read{};
+        position_t _committed{};
+        uint32_t _uncommittedRecords{};
+        recordLogStats_t _stats{};
+        mutable Mutex _mutex;
+};
\ No newline at end of file
@@ -9,18 +9,16 @@ class SPIFFSDriver : public AbstractFileSystemDriver {
     public:
         SPIFFSDriver();
         ~SPIFFSDriver();
-        std::vector<std::string> filesList(const std::string& path)const override;
-        bool deleteFile(const std::string& fullFileName) const override;
-        uint32_t countFiles (const std::string& path) const override;
-        bool writeContentToFile (const std::string& content, const std::string& filename) const override;
-        bool appendContentToFile (const std::string& content, const std::string& filename) const override;
-        bool readEntireFileToString (const std::string& filename, std::string& output) const override;
-        bool doesFileExist(const std::string& filename) const override;
+        bool deleteFile(std::string_view fullFileName) const override;
+        bool renameFile(std::string_view from, std::string_view to) const override;
+        bool doesFileExist(std::string_view filename) const override;
         float usagePercent() const override;
+        size_t totalBytes() const override;
         void initialize() override;
         bool format() const override;
-    private:
-        bool printContentToStream(const std::string& content, Stream& stream) const;
-        bool doWriteContentToFile(const std::string& content, const std::string& filename, const bool append = false) const;
+        directoryReader_t openDirectory(const std::string& path) const override;
+    protected:
+        fileReader_t doOpenForReading(std::string_view filename) const override;
+        fileWriter_t doOpenForWriting(std::string_view filename, const eWriteMode mode) const override;
 };
 #endif
\ No newline at end of file
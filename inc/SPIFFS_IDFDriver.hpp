@@ -2,25 +2,134 @@
 
 #include "AbstractFileSystemDriver.hpp"
 #include "esp_spiffs.h"
+#include "FileIndex.hpp"
+#include "LatencyHistogram.hpp"
+#include "AsyncFunctor.hpp"
+#include "mutex.hpp"
+#include <atomic>
+#include <memory>
+#include <optional>
 
 #define SPIFFS_IDF_DEFAULT_PATH             "/spiffs"
 #define SPIFFS_IDF_DEFAULT_MAX_FILES        1024
+#define SPIFFS_GC_DEFAULT_USAGE_WATERMARK   (70.0F)
+#define SPIFFS_GC_DEFAULT_QUIET_PERIOD_MS   (2000)
+#define SPIFFS_GC_DEFAULT_CHECK_PERIOD_MS   (1000)
+#define SPIFFS_GC_DEFAULT_GC_BYTES          (16 * 1024)
+#define SPIFFS_GC_DEFAULT_STACK_SIZE        (configMINIMAL_STACK_SIZE * 4)
+
+#define SPIFFS_CHECK_DEFAULT_STACK_SIZE     (configMINIMAL_STACK_SIZE * 4)
+#define SPIFFS_CHECK_MARKER_STORAGE         "spiffs_drv"
+
+enum class eSpiffsCheckMode {
+    /// esp_spiffs_check before mount returns, as it always was
+    CHECK_ALWAYS,
+    /// filesystem is usable at once, check runs on its own task
+    CHECK_IN_BACKGROUND,
+    /// check before mount returns, but only if previous session did not end cleanly
+    CHECK_AFTER_UNCLEAN_SHUTDOWN,
+    CHECK_IN_BACKGROUND_AFTER_UNCLEAN_SHUTDOWN
+};
+
+enum class eSpiffsCheckState {
+    CHECK_NOT_STARTED,
+    CHECK_RUNNING,
+    CHECK_PASSED,
+    CHECK_FAILED,
+    /// previous shutdown was clean
+    CHECK_SKIPPED
+};
+
+struct spiffsMountStats_t {
+    /// time spent in initialize(), check included only when it was not deferred
+    uint32_t mountUs;
+    uint32_t checkUs;
+    bool checkDeferred;
+};
+
+struct spiffsGcConfig_t {
+    /// gc runs only while usage is at or above this percent
+    float usageWatermarkPercent {SPIFFS_GC_DEFAULT_USAGE_WATERMARK};
+    /// and no write was done through the driver for this long
+    uint32_t quietPeriodMs {SPIFFS_GC_DEFAULT_QUIET_PERIOD_MS};
+    uint32_t checkPeriodMs {SPIFFS_GC_DEFAULT_CHECK_PERIOD_MS};
+    /// bytes esp_spiffs_gc should try to make available per run
+    size_t gcBytes {SPIFFS_GC_DEFAULT_GC_BYTES};
+};
+
+struct spiffsGcStats_t {
+    uint32_t runs;
+    uint32_t failures;
+    uint32_t lastDurationUs;
+    uint64_t totalDurationUs;
+};
 
 struct SPIFFS_IDFDriver : AbstractFileSystemDriver {
+    /// useIndex keeps names, sizes and digests in RAM, directory scans and stat happen only at mount
+    /// unclean shutdown marker lives in NVS, nvs_flash_init should be done before mount in those modes
     explicit SPIFFS_IDFDriver(const char* const path = SPIFFS_IDF_DEFAULT_PATH,
-        const size_t maxFiles = SPIFFS_IDF_DEFAULT_MAX_FILES);
+        const size_t maxFiles = SPIFFS_IDF_DEFAULT_MAX_FILES, const bool useIndex = false,
+        const eSpiffsCheckMode checkMode = eSpiffsCheckMode::CHECK_ALWAYS);
     ~SPIFFS_IDFDriver();
-    std::vector<std::string> filesList(const std::string& path)const override;
-    bool deleteFile(const std::string& fullFileName) const override;
-    uint32_t countFiles (const std::string& path)const override;
-    bool writeContentToFile (const std::string& content, const std::string& filename) const override;
-    bool appendContentToFile (const std::string& content, const std::string& filename) const override;
-    bool readEntireFileToString (const std::string& filename, std::string& output) const override;
-    bool doesFileExist(const std::string& filename) const override;
+    bool deleteFile(std::string_view fullFileName) const override;
+    bool renameFile(std::string_view from, std::string_view to) const override;
+    bool doesFileExist(std::string_view filename) const override;
+    bool getFileSize(std::string_view filename, size_t& size) const override;
+    std::string getFileDigest(std::string_view filename, const eDigestType type) const override;
+    uint32_t countFiles (const std::string& path) const override;
+    bool deleteMany(const std::vector<std::string>& filenames) const override;
+    std::vector<bool> existsMany(const std::vector<std::string>& filenames) const override;
     float usagePercent() const override;
+    size_t totalBytes() const override;
     bool format() const override;
     void initialize() override;
+    directoryReader_t openDirectory(const std::string& path) const override;
+
+    /// isReady() turns true once mounted, this tells whether consistency check is done yet
+    eSpiffsCheckState checkState() const { return _checkState; }
+    bool isChecked() const;
+    spiffsMountStats_t mountStats() const;
+
+    /// starts idle time garbage collection, so erases happen between writes instead of inside them
+    bool startMaintenance(const spiffsGcConfig_t& config = spiffsGcConfig_t{});
+    /// waits for running gc pass to finish
+    void stopMaintenance();
+    spiffsGcStats_t gcStats() const;
+    /// open to close duration of writers opened while tracking is enabled, off by default
+    void setWriteLatencyTracking(const bool enabled) { _trackWriteLatency = enabled; }
+    latencySummary_t writeLatency() const;
+    void resetWriteLatency();
+protected:
+    fileReader_t doOpenForReading(std::string_view filename) const override;
+    fileWriter_t doOpenForWriting(std::string_view filename, const eWriteMode mode) const override;
 private:
-    bool doWriteContentToFile(const std::string& content, FILE* file) const;
+    void buildIndex();
+    bool runCheck();
+    void waitForCheck() const;
+    bool wasShutdownClean() const;
+    void setShutdownClean(const bool clean) const;
+    bool unlinkFile(std::string_view filename) const;
+    void maintenanceLoop();
+    void collectGarbage();
+    friend struct TimedFileWriter;
+    void onWriteDone(const uint32_t durationUs) const;
     esp_vfs_spiffs_conf_t _conf{};
+    std::unique_ptr<FileIndex> _index;
+    eSpiffsCheckMode _checkMode;
+    std::atomic<eSpiffsCheckState> _checkState{eSpiffsCheckState::CHECK_NOT_STARTED};
+    /// guarded by _statsMutex, background check writes it
+    spiffsMountStats_t _mountStats{};
+    std::unique_ptr<AsyncFunctor> _checkTask;
+    uint32_t _rebootHookId{};
+    /// last value read from or written to NVS, marker is written only when it changes
+    mutable std::optional<bool> _shutdownClean;
+    spiffsGcConfig_t _gcConfig{};
+    spiffsGcStats_t _gcStats{};
+    std::unique_ptr<AsyncFunctor> _maintenance;
+    std::atomic<bool> _maintenanceRequested{false};
+    std::atomic<bool> _maintenanceRunning{false};
+    mutable std::atomic<uint32_t> _lastWriteMs{0};
+    std::atomic<bool> _trackWriteLatency{false};
+    mutable LatencyHistogram _writeLatency;
+    mutable Mutex _statsMutex;
 };
\ No newline at end of file
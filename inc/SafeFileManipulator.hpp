@@ -1,41 +1,87 @@
 #pragma once
 
 #include "IFileManipulator.hpp"
+#include <initializer_list>
+#include <atomic>
 
 enum class eSafeFileSaverMode{
     MODE_NORMAL,
     MODE_USE_MD5,
     MODE_USE_MD5_AND_BACKUP,
+    MODE_FRAMED,
     MODE_INVALID,
 };
 
+struct dedupStats_t {
+    uint32_t hits;      // saves skipped because stored content is identical
+    uint32_t misses;    // saves which went to flash
+};
+
 enum class eSafeSaverFileType{
     FILE_MAIN,
     FILE_BACKUP,
     FILE_MD5_MAIN,
     FILE_MD5_BACKUP,
+    FILE_FRAMED,
+    FILE_TEMP,
+    FILE_MD5_TEMP,
+    /// framed and backup mode commit through it, never shared with md5 mode temp
+    FILE_FRAMED_TEMP,
 };
 
 class SafeFileManipulator : public IFileManipulator {
 
     public:
-        explicit SafeFileManipulator(const eSafeFileSaverMode mode, IFileSystemDriver* driver);
+        explicit SafeFileManipulator(const eSafeFileSaverMode mode, IFileSystemDriver* driver,
+            const eDigestType digestType = eDigestType::DIGEST_MD5);
 
-        bool saveContentToFile(const std::string& content, const std::string& filename) const override;
-        bool appendContentToFile(const std::string& content, const std::string& filename) const override;
+        bool saveContentToFile(std::string_view content, const std::string& filename) const override;
+        bool appendContentToFile(std::string_view content, const std::string& filename) const override;
         std::pair<bool, std::string> loadContentFromFile(const std::string& filename) const override;
         uint32_t countFilesInDirectory(const std::string& directory) const override;
         std::vector<std::string> dataFilesList (const std::string& directory) const override;
         bool doesFileExist(const std::string& filename) const override;
         bool deleteFile(const std::string& filename) const override;
         bool deleteAllFiles(const std::string& directory) const;
+        /// compare digest of new content with the stored one and skip identical saves, not available in MODE_NORMAL
+        void setSkipUnchangedWrites(const bool enable) { _skipUnchangedWrites = enable; }
+        dedupStats_t dedupStats() const {
+            return dedupStats_t{_dedupStats.hits.load(std::memory_order_relaxed), _dedupStats.misses.load(std::memory_order_relaxed)};
+        }
     private:
         eSafeFileSaverMode _mode;
-        bool saveInNormalMode(const std::string& content, const std::string& filename, const bool append) const;
-        bool saveInMd5Mode(const std::string& content, const std::string& filename, const bool append) const;
-        bool saveInMd5BackupMode(const std::string& content, const std::string& filename, const bool append) const;
+        eDigestType _digestType;
+        bool _skipUnchangedWrites{false};
+        // saves may run from several tasks
+        mutable struct {
+            std::atomic<uint32_t> hits{0};
+            std::atomic<uint32_t> misses{0};
+        } _dedupStats;
+        bool isContentUnchanged(std::string_view content, const std::string& filename) const;
+        bool isStoredDataIntact(IFileReader& reader, const size_t length, std::string_view fileName, const std::string& expectedDigest) const;
+        /// every file which may hold data of filename in current mode
+        std::vector<std::string> storedFileNames(const std::string& filename) const;
+        template<typename key_t, typename keyOf_t>
+        std::vector<key_t> collectDataFiles(const std::string& directory, keyOf_t keyOf) const;
+        bool saveInNormalMode(std::string_view content, const std::string& filename, const bool append) const;
+        bool saveInMd5Mode(std::string_view content, const std::string& filename, const bool append) const;
+        bool saveInMd5BackupMode(std::string_view content, const std::string& filename, const bool append) const;
+        bool saveInFramedMode(std::string_view content, const std::string& filename, const bool append) const;
         std::pair<bool, std::string> loadInNormalMode(const std::string& filename) const;
         std::pair<bool, std::string> loadInMd5Mode(const std::string& filename) const;
+        std::pair<bool, std::string> loadMd5Pair(std::string_view dataFileName, std::string_view md5FileName) const;
         std::pair<bool, std::string> loadInMd5BackupMode(const std::string& filename) const;
-        std::string getFileNameWithExtension(const std::string& filename, const eSafeSaverFileType type) const;
+        std::pair<bool, std::string> loadInFramedMode(const std::string& filename) const;
+        std::pair<bool, std::string> loadFramedFile(std::string_view framedFileName) const;
+        bool commitFramedFile(std::string_view content, const std::string& filename, const bool keepBackup) const;
+        bool writeAndSync(std::string_view fileName, std::initializer_list<std::span<const char>> parts,
+            const eWriteMode mode = eWriteMode::WRITE_TRUNCATE) const;
+        bool appendToFramedFile(std::string_view content, const std::string& filename) const;
+        bool migrateToFramed(const std::string& filename) const;
+        void dropLegacyFiles(const std::string& filename) const;
+        /// built on stack, no allocation on the save and load paths
+        FilePath getFileNameWithExtension(std::string_view filename, const eSafeSaverFileType type) const;
+        bool resumeDigest(std::string_view mainFileName, std::string_view md5FileName, Digest& digest, size_t& dataLength) const;
+        std::string makeMd5FileContent(Digest& digest, const size_t dataLength) const;
+        static std::string digestFromMd5FileContent(const std::string& md5FileContent);
 };
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "IFileStream.hpp"
+#include "FilePath.hpp"
+#include <stdio.h>
+#include <dirent.h>
+#include <string>
+#include <string_view>
+
+const char* openModeString(const eWriteMode mode);
+/// creates missing directories of path, for filesystems with real directories
+/// first prefixLength characters (e.g. mount point) are assumed to exist
+bool makeParentDirectories(std::string_view path, const size_t prefixLength = 0);
+
+struct StdioFileReader : IFileReader {
+    explicit StdioFileReader(FILE* file);
+    ~StdioFileReader();
+    size_t read(std::span<char> buffer) override;
+    size_t size() const override { return _size; }
+private:
+    FILE* _file;
+    size_t _size{};
+};
+
+struct StdioFileWriter : IFileWriter {
+    explicit StdioFileWriter(FILE* file);
+    ~StdioFileWriter();
+    size_t write(std::span<const char> data) override;
+    bool sync() override;
+    bool close() override;
+private:
+    FILE* _file;
+};
+
+
+struct DirentDirectoryReader : IDirectoryReader {
+    explicit DirentDirectoryReader(DIR* dir);
+    ~DirentDirectoryReader();
+    const char* next() override;
+private:
+    DIR* _dir;
+};
\ No newline at end of file
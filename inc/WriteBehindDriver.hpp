@@ -0,0 +1,88 @@
+#pragma once
+
+#include "FileSystemDriverDecorator.hpp"
+#include "mutex.hpp"
+#include <map>
+
+#define WRITE_BEHIND_DEFAULT_MAX_OPEN_FILES     (3)
+#define WRITE_BEHIND_DEFAULT_FLUSH_THRESHOLD    (1024)
+#define WRITE_BEHIND_DEFAULT_MEMORY_BUDGET      (4096)
+#define WRITE_BEHIND_DEFAULT_MAX_AGE_MS         (5000)
+
+struct writeBehindConfig_t {
+    /// files with pending data or open handle, least recently used one is flushed and closed above the limit
+    size_t maxOpenFiles {WRITE_BEHIND_DEFAULT_MAX_OPEN_FILES};
+    /// per file buffer is written once it reaches this size
+    size_t flushThreshold {WRITE_BEHIND_DEFAULT_FLUSH_THRESHOLD};
+    /// total buffered bytes, biggest buffers are written first when exceeded
+    size_t memoryBudget {WRITE_BEHIND_DEFAULT_MEMORY_BUDGET};
+    uint32_t maxAgeMs {WRITE_BEHIND_DEFAULT_MAX_AGE_MS};
+};
+
+struct writeBehindStats_t {
+    uint32_t appends;
+    uint32_t flushes;
+    /// successful opens of append handles, failed ones are in openFailures
+    uint32_t opens;
+    uint32_t openFailures;
+    /// flushes which lost data, failed opens included
+    uint32_t failures;
+};
+
+/// coalesces appendContentToFile calls in RAM and keeps append handles open between flushes
+/// buffered data is lost on power loss, write errors are reported by the call which triggered the flush
+/// age is checked on every call and by flushExpired(), which should be called periodically by the owner
+/// pending data is flushed before reboot via ESP32Utils reboot hook
+class WriteBehindDriver : public FileSystemDriverDecorator {
+    public:
+        explicit WriteBehindDriver(IFileSystemDriver* driver, const writeBehindConfig_t& config = writeBehindConfig_t{});
+        ~WriteBehindDriver() override;
+
+        /// writes all pending data and closes handles, any other access to a buffered file does the same for that file
+        bool flush() const;
+        bool flushExpired() const;
+        writeBehindStats_t stats() const;
+
+        bool writeContentToFile (std::string_view content, std::string_view filename) const override;
+        bool format() const override;
+        bool deleteFile(std::string_view fullFileName) const override;
+        bool writeMany(const fileContents_t& files) const override;
+        bool deleteMany(const std::vector<std::string>& filenames) const override;
+        std::vector<bool> existsMany(const std::vector<std::string>& filenames) const override;
+        bool renameFile(std::string_view from, std::string_view to) const override;
+        std::vector<std::string> filesList(const std::string& path) const override;
+        uint32_t countFiles (const std::string& path) const override;
+        bool readEntireFileToString (std::string_view filename, std::string& output) const override;
+        bool readFileToBuffer(std::string_view filename, std::span<char> buffer, size_t& length) const override;
+        bool appendContentToFile (std::string_view content, std::string_view filename) const override;
+        bool doesFileExist(std::string_view filename) const override;
+        bool getFileSize(std::string_view filename, size_t& size) const override;
+        std::string getFileMd5(std::string_view filename) const override;
+        std::string getFileDigest(std::string_view filename, const eDigestType type) const override;
+        fileReader_t openForReading(std::string_view filename) const override;
+        fileWriter_t openForWriting(std::string_view filename, const eWriteMode mode = eWriteMode::WRITE_TRUNCATE) const override;
+        directoryReader_t openDirectory(const std::string& path) const override;
+    private:
+        struct pendingFile_t {
+            std::string buffer;
+            fileWriter_t writer;
+            uint32_t firstPendingMs;
+            uint32_t lastUsedMs;
+        };
+        // transparent comparator, lookups by view don't build a key string
+        using pendingFiles_t = std::map<std::string, pendingFile_t, std::less<>>;
+
+        pendingFile_t& acquire(std::string_view filename) const;
+        bool writePending(std::string_view filename, pendingFile_t& file, std::span<const char> extra = {}) const;
+        void release(std::string_view filename, const bool keepPending) const;
+        bool flushAll() const;
+        bool flushExpiredLocked() const;
+        bool enforceMemoryBudget() const;
+
+        const writeBehindConfig_t _config;
+        mutable pendingFiles_t _files;
+        mutable size_t _bufferedBytes{};
+        mutable writeBehindStats_t _stats{};
+        mutable Mutex _mutex;
+        uint32_t _rebootHookId{};
+};
\ No newline at end of file
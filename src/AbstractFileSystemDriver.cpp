@@ -1,21 +1,309 @@
 #include "AbstractFileSystemDriver.hpp"
-#include "md5.hpp"
+#include "esp_log.h"
+#include <map>
+#include <unordered_set>
 
-std::string AbstractFileSystemDriver::getFileMd5(const string& filename) const {
-    
-    std::string ret{};
-    
-    if(false == doesFileExist(filename)) {
+static const char* const TAG {"AbstractFileSystemDriver"};
+
+#if CONFIG_ENABLE_FS_DRIVER_STATS
+// records one operation per stream, so writes of every caller are counted, not only content methods
+struct CountingFileReader : IFileReader {
+    CountingFileReader(fileReader_t&& reader, FileSystemStats& stats, const int64_t openedUs)
+        :   _reader{std::move(reader)}, _stats{stats}, _openedUs{openedUs} {}
+    ~CountingFileReader() {
+        _stats.record(eFsOperation::FS_OP_READ, _bytesRead, static_cast<uint32_t>(esp_timer_get_time() - _openedUs), false == _failed);
+    }
+    size_t read(std::span<char> buffer) override {
+        const size_t bytesRead {_reader->read(buffer)};
+        _bytesRead += bytesRead;
+        // short read before the end of file is an error, at the end it is just EOF
+        _failed = _failed or (bytesRead < buffer.size() and _bytesRead < _reader->size());
+        return bytesRead;
+    }
+    size_t size() const override { return _reader->size(); }
+private:
+    fileReader_t _reader;
+    FileSystemStats& _stats;
+    int64_t _openedUs;
+    uint64_t _bytesRead{};
+    bool _failed{false};
+};
+
+struct CountingFileWriter : IFileWriter {
+    CountingFileWriter(fileWriter_t&& writer, FileSystemStats& stats, const eFsOperation op, const int64_t openedUs)
+        :   _writer{std::move(writer)}, _stats{stats}, _op{op}, _openedUs{openedUs} {}
+    ~CountingFileWriter() { close(); }
+    size_t write(std::span<const char> data) override {
+        const size_t written {_writer->write(data)};
+        _bytesWritten += written;
+        _failed = _failed or written != data.size();
+        return written;
+    }
+    bool sync() override {
+        const bool ret {_writer->sync()};
+        _failed = _failed or false == ret;
         return ret;
     }
+    bool close() override {
+        if (_closed) {
+            return false;
+        }
+        _closed = true;
+        const bool ret {_writer->close()};
+        _stats.record(_op, _bytesWritten, static_cast<uint32_t>(esp_timer_get_time() - _openedUs), ret and false == _failed);
+        return ret;
+    }
+private:
+    fileWriter_t _writer;
+    FileSystemStats& _stats;
+    eFsOperation _op;
+    int64_t _openedUs;
+    uint64_t _bytesWritten{};
+    bool _failed{false};
+    bool _closed{false};
+};
+#endif
+
+// read() may return less than asked before EOF, e.g. one decoded block per call
+static size_t readFully(IFileReader& reader, std::span<char> buffer) {
+    size_t length {0};
+    while (length < buffer.size()) {
+        const size_t bytesRead {reader.read(buffer.subspan(length))};
+        if (0 == bytesRead) {
+            break;
+        }
+        length += bytesRead;
+    }
+    return length;
+}
+
+fileReader_t AbstractFileSystemDriver::openForReading(std::string_view filename) const {
+#if CONFIG_ENABLE_FS_DRIVER_STATS
+    FS_STATS_BEGIN();
+    auto reader {doOpenForReading(filename)};
+    if (!reader) {
+        FS_STATS_END(eFsOperation::FS_OP_READ, 0, false);
+        return nullptr;
+    }
+    return std::make_unique<CountingFileReader>(std::move(reader), _fsStats, fsStatsStartUs);
+#else
+    return doOpenForReading(filename);
+#endif
+}
+
+fileWriter_t AbstractFileSystemDriver::openForWriting(std::string_view filename, const eWriteMode mode) const {
+#if CONFIG_ENABLE_FS_DRIVER_STATS
+    FS_STATS_BEGIN();
+    const eFsOperation op {eWriteMode::WRITE_APPEND == mode ? eFsOperation::FS_OP_APPEND : eFsOperation::FS_OP_WRITE};
+    auto writer {doOpenForWriting(filename, mode)};
+    if (!writer) {
+        FS_STATS_END(op, 0, false);
+        return nullptr;
+    }
+    return std::make_unique<CountingFileWriter>(std::move(writer), _fsStats, op, fsStatsStartUs);
+#else
+    return doOpenForWriting(filename, mode);
+#endif
+}
+
+bool AbstractFileSystemDriver::writeContentToFile (std::string_view content, std::string_view filename) const {
+    return doWriteContentToFile(content, filename, eWriteMode::WRITE_TRUNCATE);
+}
+
+bool AbstractFileSystemDriver::appendContentToFile (std::string_view content, std::string_view filename) const {
+    return doWriteContentToFile(content, filename, eWriteMode::WRITE_APPEND);
+}
+
+bool AbstractFileSystemDriver::doWriteContentToFile(std::string_view content, std::string_view filename, const eWriteMode mode) const {
+
+    auto writer {openForWriting(filename, mode)};
+    if (!writer) {
+        ESP_LOGE(TAG, "Failed to open file for writing: " PATH_FMT, PATH_ARG(filename));
+        return false;
+    }
+
+    if (content.length() != writer->write(content)) {
+        ESP_LOGE(TAG, "write operation failed: " PATH_FMT, PATH_ARG(filename));
+        writer->close();
+        return false;
+    }
+
+    return writer->close();
+}
+
+bool AbstractFileSystemDriver::readEntireFileToString (std::string_view filename, std::string& output) const {
+
+    auto reader {openForReading(filename)};
+    if (!reader) {
+        return false;
+    }
 
-    std::string fileContent {};
+    const size_t fileSize {reader->size()};
+    std::string content(fileSize, '\0');
 
-    if (false == readEntireFileToString(filename, fileContent)) {
+    if (fileSize != readFully(*reader, content)) {
+        ESP_LOGE(TAG, "read operation failed: " PATH_FMT, PATH_ARG(filename));
+        return false;
+    }
+
+    output.swap(content);
+    return true;
+}
+
+bool AbstractFileSystemDriver::readFileToBuffer(std::string_view filename, std::span<char> buffer, size_t& length) const {
+
+    auto reader {openForReading(filename)};
+    if (!reader or reader->size() > buffer.size()) {
+        return false;
+    }
+
+    length = readFully(*reader, buffer.first(reader->size()));
+    return length == reader->size();
+}
+
+std::vector<std::string> AbstractFileSystemDriver::filesList(const std::string& path) const {
+
+    std::vector<std::string> ret;
+
+    auto directory {openDirectory(path)};
+    if (!directory) {
         return ret;
     }
 
-    ret = getMD5String(fileContent);
+    while (const char* const name = directory->next()) {
+        ret.emplace_back(name);
+    }
+
+    return ret;
+}
+
+uint32_t AbstractFileSystemDriver::countFiles (const std::string& path) const {
+
+    uint32_t ret {0};
+
+    auto directory {openDirectory(path)};
+    if (!directory) {
+        return ret;
+    }
+
+    while (directory->next()) {
+        ++ret;
+    }
+
+    return ret;
+}
+
+bool AbstractFileSystemDriver::writeMany(const fileContents_t& files) const {
+
+    bool ret {true};
+    for (const auto& [filename, content] : files) {
+        ret = writeContentToFile(content, filename) and ret;
+    }
+    return ret;
+}
+
+bool AbstractFileSystemDriver::deleteMany(const std::vector<std::string>& filenames) const {
+
+    bool ret {true};
+    const std::vector<bool> exists {existsMany(filenames)};
+
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        if (exists[i]) {
+            ret = deleteFile(filenames[i]) and ret;
+        }
+    }
+    return ret;
+}
+
+std::vector<bool> AbstractFileSystemDriver::existsMany(const std::vector<std::string>& filenames) const {
+
+    std::vector<bool> ret(filenames.size(), false);
+    std::map<std::string, std::vector<size_t>> byDirectory {};
+
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        const size_t separator {filenames[i].rfind('/')};
+        if (std::string::npos == separator) {
+            ret[i] = doesFileExist(filenames[i]);
+            continue;
+        }
+        byDirectory[filenames[i].substr(0, separator)].push_back(i);
+    }
+
+    for (const auto& [path, indexes] : byDirectory) {
+        auto directory {openDirectory(path)};
+        if (!directory) {
+            for (const size_t i : indexes) {
+                ret[i] = doesFileExist(filenames[i]);
+            }
+            continue;
+        }
+
+        std::unordered_set<std::string> names {};
+        while (const char* const name = directory->next()) {
+            names.emplace(name);
+        }
+        for (const size_t i : indexes) {
+            ret[i] = names.count(filenames[i].substr(path.length() + 1));
+        }
+    }
+    return ret;
+}
+
+bool AbstractFileSystemDriver::getFileSize(std::string_view filename, size_t& size) const {
+
+    auto reader {openForReading(filename)};
+    if (!reader) {
+        return false;
+    }
+
+    size = reader->size();
+    return true;
+}
+
+std::string AbstractFileSystemDriver::getFileMd5(std::string_view filename) const {
+    return getFileDigest(filename, eDigestType::DIGEST_MD5);
+}
+
+std::string AbstractFileSystemDriver::getFileDigest(std::string_view filename, const eDigestType type) const {
+
+    FS_STATS_BEGIN();
+    auto reader {openForReading(filename)};
+    if (!reader) {
+        FS_STATS_END(eFsOperation::FS_OP_DIGEST, 0, false);
+        return "";
+    }
+
+    Digest digest{type};
+    if (false == digest.update(*reader)) {
+        ESP_LOGE(TAG, "read operation failed: " PATH_FMT, PATH_ARG(filename));
+        FS_STATS_END(eFsOperation::FS_OP_DIGEST, 0, false);
+        return "";
+    }
+
+    FS_STATS_END(eFsOperation::FS_OP_DIGEST, reader->size(), true);
+    return digest.finish();
+}
+
+fsStats_t AbstractFileSystemDriver::operationStats() const {
+#if CONFIG_ENABLE_FS_DRIVER_STATS
+    return _fsStats.snapshot();
+#else
+    return fsStats_t{};
+#endif
+}
+
+void AbstractFileSystemDriver::resetOperationStats() {
+#if CONFIG_ENABLE_FS_DRIVER_STATS
+    _fsStats.reset();
+#endif
+}
 
+flashWearEstimate_t AbstractFileSystemDriver::flashWearEstimate(const uint32_t ratedEraseCycles) const {
+#if CONFIG_ENABLE_FS_DRIVER_STATS
+    return _fsStats.wearEstimate(totalBytes(), ratedEraseCycles);
+#else
+    flashWearEstimate_t ret {};
+    ret.partitionBytes = totalBytes();
     return ret;
+#endif
 }
\ No newline at end of file
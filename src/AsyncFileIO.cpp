@@ -0,0 +1,166 @@
+#include "AsyncFileIO.hpp"
+#include "mutex_locker.hpp"
+#include <unordered_set>
+#include <assert.h>
+
+static const uint32_t drainPollPeriodMs {10};
+
+AsyncFileIO::AsyncFileIO(IFileSystemDriver* driver, const uint16_t stackSize, const uint8_t priority)
+    :   Task("AsyncFileIO", stackSize, priority),
+        _driver{driver},
+        _wakeUp{xSemaphoreCreateBinary()} {
+    assert(NULL != driver);
+    assert(NULL != _wakeUp);
+    start();
+}
+
+AsyncFileIO::~AsyncFileIO() {
+    while (0 != pending()) {
+        Task::delay(drainPollPeriodMs);
+    }
+    stop();
+    vSemaphoreDelete(_wakeUp);
+    delete _driver;
+}
+
+void AsyncFileIO::write(const std::string& content, const std::string& filename, done_t done) {
+    submit(filename, [content, filename, done](IFileSystemDriver& driver) {
+        const bool ret {driver.writeContentToFile(content, filename)};
+        if (done) {
+            done(ret);
+        }
+    });
+}
+
+void AsyncFileIO::append(const std::string& content, const std::string& filename, done_t done) {
+    job_t job {filename, false, nullptr, true, content, {}};
+    if (done) {
+        job.appendDone.push_back(done);
+    }
+    enqueue(std::move(job));
+}
+
+void AsyncFileIO::remove(const std::string& filename, done_t done) {
+    submit(filename, [filename, done](IFileSystemDriver& driver) {
+        const bool ret {driver.deleteFile(filename)};
+        if (done) {
+            done(ret);
+        }
+    });
+}
+
+void AsyncFileIO::read(const std::string& filename, readDone_t done) {
+    submit(filename, [filename, done](IFileSystemDriver& driver) {
+        std::string content {};
+        const bool ret {driver.readEntireFileToString(filename, content)};
+        if (done) {
+            done(ret, content);
+        }
+    }, true);
+}
+
+std::future<bool> AsyncFileIO::write(const std::string& content, const std::string& filename) {
+    auto promise {std::make_shared<std::promise<bool>>()};
+    write(content, filename, [promise](const bool ret) { promise->set_value(ret); });
+    return promise->get_future();
+}
+
+std::future<bool> AsyncFileIO::append(const std::string& content, const std::string& filename) {
+    auto promise {std::make_shared<std::promise<bool>>()};
+    append(content, filename, [promise](const bool ret) { promise->set_value(ret); });
+    return promise->get_future();
+}
+
+std::future<bool> AsyncFileIO::remove(const std::string& filename) {
+    auto promise {std::make_shared<std::promise<bool>>()};
+    remove(filename, [promise](const bool ret) { promise->set_value(ret); });
+    return promise->get_future();
+}
+
+std::future<std::pair<bool, std::string>> AsyncFileIO::read(const std::string& filename) {
+    auto promise {std::make_shared<std::promise<std::pair<bool, std::string>>>()};
+    read(filename, [promise](const bool ret, std::string& content) { promise->set_value(std::make_pair(ret, std::move(content))); });
+    return promise->get_future();
+}
+
+void AsyncFileIO::submit(const std::string& filename, work_t work, const bool readOnly) {
+    enqueue(job_t{filename, readOnly, work, false, "", {}});
+}
+
+size_t AsyncFileIO::pending() const {
+    MutexLocker locker{_mutex};
+    return _jobs.size() + (_busy ? 1 : 0);
+}
+
+void AsyncFileIO::enqueue(job_t&& job) {
+    {
+        MutexLocker locker{_mutex};
+
+        // merge into latest queued operation on the same file if it is an append as well
+        if (job.isAppend) {
+            for (auto it = _jobs.rbegin(); it != _jobs.rend(); ++it) {
+                if (it->filename != job.filename) {
+                    continue;
+                }
+                if (it->isAppend and it->content.size() + job.content.size() <= ASYNC_FILE_IO_MAX_BATCH_SIZE) {
+                    it->content.append(job.content);
+                    it->appendDone.insert(it->appendDone.end(), job.appendDone.begin(), job.appendDone.end());
+                    xSemaphoreGive(_wakeUp);
+                    return;
+                }
+                break;
+            }
+        }
+        _jobs.push_back(std::move(job));
+    }
+    xSemaphoreGive(_wakeUp);
+}
+
+bool AsyncFileIO::takeNext(job_t& job) {
+
+    MutexLocker locker{_mutex};
+    _busy = false;
+
+    if (_jobs.empty()) {
+        return false;
+    }
+
+    // first read whose file has nothing queued before it, slow writes of other files don't block it
+    auto next {_jobs.begin()};
+    std::unordered_set<std::string> blocked {};
+    for (auto it = _jobs.begin(); it != _jobs.end(); ++it) {
+        if (it->readOnly and 0 == blocked.count(it->filename)) {
+            next = it;
+            break;
+        }
+        blocked.insert(it->filename);
+    }
+
+    job = std::move(*next);
+    _jobs.erase(next);
+    _busy = true;
+    return true;
+}
+
+void AsyncFileIO::execute(job_t& job) {
+
+    if (false == job.isAppend) {
+        job.work(*_driver);
+        return;
+    }
+
+    const bool ret {_driver->appendContentToFile(job.content, job.filename)};
+    for (auto& done : job.appendDone) {
+        done(ret);
+    }
+}
+
+void AsyncFileIO::run(void* args) {
+    while (true) {
+        xSemaphoreTake(_wakeUp, portMAX_DELAY);
+        job_t job {};
+        while (takeNext(job)) {
+            execute(job);
+        }
+    }
+}
\ No newline at end of file
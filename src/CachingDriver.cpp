@@ -0,0 +1,279 @@
+#include "CachingDriver.hpp"
+#include "mutex_locker.hpp"
+#include <algorithm>
+
+struct CachedFileReader : IFileReader {
+    explicit CachedFileReader(std::shared_ptr<const std::string> content)
+        :   _content{std::move(content)} {
+    }
+    size_t read(std::span<char> buffer) override {
+        const size_t toRead {std::min(buffer.size(), _content->size() - _position)};
+        _content->copy(buffer.data(), toRead, _position);
+        _position += toRead;
+        return toRead;
+    }
+    size_t size() const override { return _content->size(); }
+private:
+    std::shared_ptr<const std::string> _content;
+    size_t _position{};
+};
+
+// content written through handle becomes visible only on close, so cache is dropped on both ends
+struct InvalidatingFileWriter : IFileWriter {
+    InvalidatingFileWriter(fileWriter_t&& writer, const CachingDriver& cache, std::string_view filename)
+        :   _writer{std::move(writer)}, _cache{cache}, _filename{filename} {
+    }
+    ~InvalidatingFileWriter() { close(); }
+    size_t write(std::span<const char> data) override { return _writer->write(data); }
+    bool sync() override { return _writer->sync(); }
+    bool close() override {
+        if (_closed) {
+            return false;
+        }
+        _closed = true;
+        const bool ret {_writer->close()};
+        _cache.invalidate(_filename);
+        return ret;
+    }
+private:
+    fileWriter_t _writer;
+    const CachingDriver& _cache;
+    std::string _filename;
+    bool _closed{false};
+};
+
+CachingDriver::CachingDriver(IFileSystemDriver* driver, const size_t budget, const size_t maxEntrySize)
+    :   FileSystemDriverDecorator(driver),
+        _budget{budget},
+        _maxEntrySize{std::min(budget, maxEntrySize)} {
+}
+
+cacheStats_t CachingDriver::stats() const {
+    MutexLocker locker{_mutex};
+    return _stats;
+}
+
+void CachingDriver::invalidateAll() const {
+    MutexLocker locker{_mutex};
+    dropAll();
+}
+
+void CachingDriver::invalidate(std::string_view filename) const {
+    MutexLocker locker{_mutex};
+    drop(filename);
+}
+
+void CachingDriver::dropAll() const {
+    _entries.clear();
+    _lru.clear();
+    _stats.bytesCached = 0;
+}
+
+void CachingDriver::drop(std::string_view filename) const {
+    auto found {_entries.find(filename)};
+    if (_entries.end() == found) {
+        return;
+    }
+    _stats.bytesCached -= found->second.content->size();
+    _lru.erase(found->second.lruPosition);
+    _entries.erase(found);
+}
+
+void CachingDriver::insert(std::string_view filename, content_t content) const {
+
+    while (false == _lru.empty() and _stats.bytesCached + content->size() > _budget) {
+        auto victim {_entries.find(_lru.back())};
+        _stats.bytesCached -= victim->second.content->size();
+        _entries.erase(victim);
+        _lru.pop_back();
+        ++_stats.evictions;
+    }
+
+    _lru.emplace_front(filename);
+    _stats.bytesCached += content->size();
+    _entries[_lru.front()] = cacheEntry_t{std::move(content), _lru.begin(), {}, ""};
+}
+
+CachingDriver::content_t CachingDriver::fetch(std::string_view filename, fileReader_t& uncached) const {
+
+    auto found {_entries.find(filename)};
+    if (_entries.end() != found) {
+        ++_stats.hits;
+        _lru.splice(_lru.begin(), _lru, found->second.lruPosition);
+        return found->second.content;
+    }
+
+    ++_stats.misses;
+    auto reader {_driver->openForReading(filename)};
+    if (!reader or reader->size() > _maxEntrySize) {
+        uncached = std::move(reader);
+        return nullptr;
+    }
+
+    auto content {std::make_shared<std::string>(reader->size(), '\0')};
+    if (content->size() != reader->read(*content)) {
+        return nullptr;
+    }
+    insert(filename, content);
+    return content;
+}
+
+bool CachingDriver::readEntireFileToString (std::string_view filename, std::string& output) const {
+
+    MutexLocker locker{_mutex};
+    fileReader_t uncached {};
+    const content_t content {fetch(filename, uncached)};
+
+    if (content) {
+        output = *content;
+        return true;
+    }
+    if (!uncached) {
+        return false;
+    }
+    output.assign(uncached->size(), '\0');
+    return output.size() == uncached->read(output);
+}
+
+bool CachingDriver::readFileToBuffer(std::string_view filename, std::span<char> buffer, size_t& length) const {
+
+    MutexLocker locker{_mutex};
+    fileReader_t uncached {};
+    const content_t content {fetch(filename, uncached)};
+
+    if (content) {
+        if (content->size() > buffer.size()) {
+            return false;
+        }
+        length = content->copy(buffer.data(), content->size());
+        return true;
+    }
+    if (!uncached or uncached->size() > buffer.size()) {
+        return false;
+    }
+    length = uncached->read(buffer.first(uncached->size()));
+    return length == uncached->size();
+}
+
+fileReader_t CachingDriver::openForReading(std::string_view filename) const {
+
+    MutexLocker locker{_mutex};
+    fileReader_t uncached {};
+    content_t content {fetch(filename, uncached)};
+
+    if (content) {
+        return std::make_unique<CachedFileReader>(std::move(content));
+    }
+    return uncached;
+}
+
+std::string CachingDriver::getFileMd5(std::string_view filename) const {
+    return getFileDigest(filename, eDigestType::DIGEST_MD5);
+}
+
+std::string CachingDriver::getFileDigest(std::string_view filename, const eDigestType type) const {
+
+    MutexLocker locker{_mutex};
+    fileReader_t uncached {};
+    const content_t content {fetch(filename, uncached)};
+
+    if (content) {
+        auto& digest {_entries.find(filename)->second.digests[type]};
+        if (digest.empty()) {
+            digest = Digest::ofString(*content, type);
+        }
+        return digest;
+    }
+
+    Digest digest{type};
+    if (!uncached or false == digest.update(*uncached)) {
+        return "";
+    }
+    return digest.finish();
+}
+
+bool CachingDriver::isContentVerified(std::string_view filename, const std::string& digest) const {
+    MutexLocker locker{_mutex};
+    const auto found {_entries.find(filename)};
+    return _entries.end() != found and false == digest.empty() and digest == found->second.verifiedDigest;
+}
+
+void CachingDriver::setContentVerified(std::string_view filename, const std::string& digest) const {
+    MutexLocker locker{_mutex};
+    auto found {_entries.find(filename)};
+    if (_entries.end() != found) {
+        found->second.verifiedDigest = digest;
+    }
+}
+
+bool CachingDriver::doesFileExist(std::string_view filename) const {
+    MutexLocker locker{_mutex};
+    return _entries.count(filename) or _driver->doesFileExist(filename);
+}
+
+bool CachingDriver::getFileSize(std::string_view filename, size_t& size) const {
+    MutexLocker locker{_mutex};
+    const auto found {_entries.find(filename)};
+    if (_entries.end() != found) {
+        size = found->second.content->size();
+        return true;
+    }
+    return _driver->getFileSize(filename, size);
+}
+
+bool CachingDriver::writeContentToFile (std::string_view content, std::string_view filename) const {
+    MutexLocker locker{_mutex};
+    drop(filename);
+    return _driver->writeContentToFile(content, filename);
+}
+
+bool CachingDriver::appendContentToFile (std::string_view content, std::string_view filename) const {
+    MutexLocker locker{_mutex};
+    drop(filename);
+    return _driver->appendContentToFile(content, filename);
+}
+
+bool CachingDriver::deleteFile(std::string_view fullFileName) const {
+    MutexLocker locker{_mutex};
+    drop(fullFileName);
+    return _driver->deleteFile(fullFileName);
+}
+
+bool CachingDriver::writeMany(const fileContents_t& files) const {
+    MutexLocker locker{_mutex};
+    for (const auto& file : files) {
+        drop(file.first);
+    }
+    return _driver->writeMany(files);
+}
+
+bool CachingDriver::deleteMany(const std::vector<std::string>& filenames) const {
+    MutexLocker locker{_mutex};
+    for (const auto& filename : filenames) {
+        drop(filename);
+    }
+    return _driver->deleteMany(filenames);
+}
+
+bool CachingDriver::renameFile(std::string_view from, std::string_view to) const {
+    MutexLocker locker{_mutex};
+    drop(from);
+    drop(to);
+    return _driver->renameFile(from, to);
+}
+
+bool CachingDriver::format() const {
+    MutexLocker locker{_mutex};
+    dropAll();
+    return _driver->format();
+}
+
+fileWriter_t CachingDriver::openForWriting(std::string_view filename, const eWriteMode mode) const {
+    MutexLocker locker{_mutex};
+    drop(filename);
+    auto writer {_driver->openForWriting(filename, mode)};
+    if (!writer) {
+        return nullptr;
+    }
+    return std::make_unique<InvalidatingFileWriter>(std::move(writer), *this, filename);
+}
\ No newline at end of file
@@ -0,0 +1,425 @@
+#include "CompressingDriver.hpp"
+#include "mutex_locker.hpp"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include <string.h>
+#include <algorithm>
+#include <optional>
+#include <stddef.h>
+
+static const char* const TAG {"CompressingDriver"};
+static const uint32_t compressedFileMagic {0x325A4C43};
+static const uint8_t compressedFileVersion {2};
+/// plain file is compressed into a sibling first and renamed over the original, never rewritten in place
+static const char* const compressingTempSuffix {"~z"};
+
+/// plain file is told apart by magic, version and header crc, all of them must match
+struct compressedFileHeader_t {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t codec;
+    uint8_t reserved[2];
+    uint32_t headerCrc;
+};
+
+static uint32_t compressedHeaderCrc(const compressedFileHeader_t& header) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&header), offsetof(compressedFileHeader_t, headerCrc));
+}
+
+struct blockHeader_t {
+    uint16_t rawLength;
+    /// equal to rawLength if block is stored as is
+    uint16_t storedLength;
+};
+
+static_assert(COMPRESSING_DRIVER_BLOCK_SIZE <= UINT16_MAX, "block length must fit block header");
+
+enum class eStoredFormat {
+    FORMAT_MISSING,
+    FORMAT_PLAIN,
+    FORMAT_COMPRESSED
+};
+
+static eStoredFormat readFormat(IFileReader* reader) {
+    if (!reader) {
+        return eStoredFormat::FORMAT_MISSING;
+    }
+    compressedFileHeader_t header {};
+    if (0 == reader->size()) {
+        return eStoredFormat::FORMAT_MISSING;
+    }
+    if (sizeof(header) != reader->read({reinterpret_cast<char*>(&header), sizeof(header)})
+        or compressedFileMagic != header.magic
+        or compressedFileVersion != header.version
+        or compressedHeaderCrc(header) != header.headerCrc) {
+        return eStoredFormat::FORMAT_PLAIN;
+    }
+    return eStoredFormat::FORMAT_COMPRESSED;
+}
+
+// decodes one block at a time, so only a single block of raw and stored data is held in RAM
+struct DecodingFileReader : IFileReader {
+    DecodingFileReader(fileReader_t&& stored, const CompressingDriver& driver, std::string_view filename)
+        :   _stored{std::move(stored)}, _driver{driver}, _filename{filename} {
+        _block.reserve(COMPRESSING_DRIVER_BLOCK_SIZE);
+    }
+    size_t read(std::span<char> buffer) override {
+        size_t copied {0};
+        while (copied < buffer.size()) {
+            if (_position == _block.size() and false == nextBlock()) {
+                break;
+            }
+            const size_t toCopy {_block.copy(buffer.data() + copied, buffer.size() - copied, _position)};
+            _position += toCopy;
+            copied += toCopy;
+        }
+        return copied;
+    }
+    /// uncompressed size, summed from block headers already read once the end is reached, otherwise scanned once
+    size_t size() const override {
+        if (!_size.has_value()) {
+            size_t size {0};
+            _size = _ended ? _decoded : (_driver.getFileSize(_filename, size) ? size : 0);
+        }
+        return _size.value();
+    }
+    /// tells corrupted data apart from end of file once read() returned 0
+    bool failed() const { return _failed; }
+private:
+    bool nextBlock() {
+        _block.clear();
+        _position = 0;
+        if (_failed) {
+            return false;
+        }
+
+        blockHeader_t header {};
+        const size_t headerLength {_stored->read({reinterpret_cast<char*>(&header), sizeof(header)})};
+        if (0 == headerLength) {
+            _ended = true;
+            return false;
+        }
+        if (sizeof(header) != headerLength or header.rawLength > COMPRESSING_DRIVER_BLOCK_SIZE or header.storedLength > header.rawLength) {
+            return fail();
+        }
+
+        _decoded += header.rawLength;
+        _block.resize(header.rawLength);
+        if (header.storedLength == header.rawLength) {
+            return _block.size() == _stored->read(_block) or fail();
+        }
+        _payload.resize(header.storedLength);
+        if (_payload.size() != _stored->read(_payload) or false == _driver.decodeBlock(_payload, _block)) {
+            return fail();
+        }
+        return true;
+    }
+    bool fail() {
+        ESP_LOGE(TAG, "corrupted compressed data in %s", _filename.c_str());
+        _failed = true;
+        _block.clear();
+        return false;
+    }
+    fileReader_t _stored;
+    const CompressingDriver& _driver;
+    std::string _filename;
+    std::string _block;
+    std::string _payload;
+    size_t _position{};
+    size_t _decoded{};
+    mutable std::optional<size_t> _size;
+    bool _ended{false};
+    bool _failed{false};
+};
+
+// collects raw data into blocks, each full block is encoded and written right away
+struct CompressingFileWriter : IFileWriter {
+    CompressingFileWriter(fileWriter_t&& writer, const CompressingDriver& driver, const bool writeHeader)
+        :   _writer{std::move(writer)}, _driver{driver} {
+        if (writeHeader) {
+            _driver.encodeHeader(_encoded);
+        }
+        _pending.reserve(COMPRESSING_DRIVER_BLOCK_SIZE);
+    }
+    ~CompressingFileWriter() { close(); }
+    size_t write(std::span<const char> data) override {
+        size_t written {0};
+        while (written < data.size()) {
+            const size_t toCopy {std::min(data.size() - written, COMPRESSING_DRIVER_BLOCK_SIZE - _pending.size())};
+            _pending.append(data.data() + written, toCopy);
+            written += toCopy;
+            if (COMPRESSING_DRIVER_BLOCK_SIZE == _pending.size() and false == flushBlock()) {
+                return written - toCopy;
+            }
+        }
+        return written;
+    }
+    bool sync() override {
+        return flushBlock() and _writer->sync();
+    }
+    bool close() override {
+        if (_closed) {
+            return false;
+        }
+        _closed = true;
+        const bool flushed {flushBlock()};
+        return _writer->close() and flushed;
+    }
+private:
+    bool flushBlock() {
+        _driver.encode(_pending, _encoded);
+        _pending.clear();
+        const bool ret {_encoded.size() == _writer->write(_encoded)};
+        _encoded.clear();
+        return ret;
+    }
+    fileWriter_t _writer;
+    const CompressingDriver& _driver;
+    std::string _pending;
+    std::string _encoded;
+    bool _closed{false};
+};
+
+CompressingDriver::CompressingDriver(IFileSystemDriver* driver, const eCodec codec)
+    :   FileSystemDriverDecorator(driver),
+        _codec{codec} {
+}
+
+compressionStats_t CompressingDriver::stats() const {
+    MutexLocker locker{_mutex};
+    return _stats;
+}
+
+float CompressingDriver::compressionRatio() const {
+    MutexLocker locker{_mutex};
+    return 0 == _stats.storedBytes ? 1.0F : static_cast<float>(_stats.rawBytes) / _stats.storedBytes;
+}
+
+void CompressingDriver::encodeHeader(std::string& output) const {
+    compressedFileHeader_t header {compressedFileMagic, compressedFileVersion, static_cast<uint8_t>(_codec), {}, 0};
+    header.headerCrc = compressedHeaderCrc(header);
+    output.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    MutexLocker locker{_mutex};
+    _stats.storedBytes += sizeof(header);
+}
+
+void CompressingDriver::encode(std::string_view content, std::string& output) const {
+
+    MutexLocker locker{_mutex};
+    const int64_t start {esp_timer_get_time()};
+
+    for (size_t offset = 0; offset < content.size(); offset += COMPRESSING_DRIVER_BLOCK_SIZE) {
+        const std::string_view block {content.substr(offset, COMPRESSING_DRIVER_BLOCK_SIZE)};
+        const size_t headerPosition {output.size()};
+        output.resize(headerPosition + sizeof(blockHeader_t) + block.size());
+        char* const payload {output.data() + headerPosition + sizeof(blockHeader_t)};
+
+        size_t storedLength {0};
+        if (eCodec::CODEC_LZ == _codec) {
+            // one byte less than raw, otherwise raw copy is better
+            storedLength = _lz.compress(block, {payload, block.size() - 1});
+        }
+        if (0 == storedLength) {
+            memcpy(payload, block.data(), block.size());
+            storedLength = block.size();
+        }
+
+        const blockHeader_t header {static_cast<uint16_t>(block.size()), static_cast<uint16_t>(storedLength)};
+        memcpy(output.data() + headerPosition, &header, sizeof(header));
+        output.resize(headerPosition + sizeof(header) + storedLength);
+
+        _stats.rawBytes += block.size();
+        _stats.storedBytes += sizeof(header) + storedLength;
+    }
+
+    _stats.compressUs += esp_timer_get_time() - start;
+}
+
+bool CompressingDriver::decodeBlock(std::span<const char> stored, std::span<char> output) const {
+
+    const int64_t start {esp_timer_get_time()};
+    const bool ret {LzCodec::decompress(stored, output)};
+
+    MutexLocker locker{_mutex};
+    _stats.decompressUs += esp_timer_get_time() - start;
+    return ret;
+}
+
+template <typename Consumer>
+bool CompressingDriver::readDecoded(std::string_view filename, Consumer&& consume) const {
+
+    auto stored {_driver->openForReading(filename)};
+    if (!stored) {
+        return false;
+    }
+
+    char chunk[FILE_STREAM_DEFAULT_CHUNK_SIZE];
+    if (eStoredFormat::FORMAT_COMPRESSED != readFormat(stored.get())) {
+        // plain content is read from the beginning
+        stored = _driver->openForReading(filename);
+        if (!stored) {
+            return false;
+        }
+        for (size_t length = stored->read(chunk); length; length = stored->read(chunk)) {
+            if (false == consume(std::span<const char>{chunk, length})) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    DecodingFileReader decoded {std::move(stored), *this, filename};
+    for (size_t length = decoded.read(chunk); length; length = decoded.read(chunk)) {
+        if (false == consume(std::span<const char>{chunk, length})) {
+            return false;
+        }
+    }
+    return false == decoded.failed();
+}
+
+bool CompressingDriver::writeContentToFile (std::string_view content, std::string_view filename) const {
+    std::string encoded {};
+    encoded.reserve(sizeof(compressedFileHeader_t) + content.size() / 2);
+    encodeHeader(encoded);
+    encode(content, encoded);
+    return _driver->writeContentToFile(encoded, filename);
+}
+
+bool CompressingDriver::appendContentToFile (std::string_view content, std::string_view filename) const {
+
+    auto reader {_driver->openForReading(filename)};
+    const eStoredFormat format {readFormat(reader.get())};
+    reader.reset();
+
+    switch (format) {
+        case eStoredFormat::FORMAT_PLAIN:
+            if (false == migrateToCompressed(filename)) {
+                return false;
+            }
+            [[fallthrough]];
+        case eStoredFormat::FORMAT_COMPRESSED: {
+            std::string encoded {};
+            encode(content, encoded);
+            return _driver->appendContentToFile(encoded, filename);
+        }
+        case eStoredFormat::FORMAT_MISSING:
+        default:
+            return writeContentToFile(content, filename);
+    }
+}
+
+bool CompressingDriver::migrateToCompressed(std::string_view filename) const {
+    std::string plain {};
+    if (false == _driver->readEntireFileToString(filename, plain)) {
+        return false;
+    }
+    const FilePath tempFileName {filename, compressingTempSuffix};
+    if (tempFileName.empty() or false == writeContentToFile(plain, tempFileName)) {
+        ESP_LOGE(TAG, "failed to migrate " PATH_FMT " to compressed format", PATH_ARG(filename));
+        return false;
+    }
+    return _driver->renameFile(tempFileName, filename);
+}
+
+bool CompressingDriver::writeMany(const fileContents_t& files) const {
+    bool ret {true};
+    for (const auto& [filename, content] : files) {
+        ret = writeContentToFile(content, filename) and ret;
+    }
+    return ret;
+}
+
+bool CompressingDriver::readEntireFileToString (std::string_view filename, std::string& output) const {
+    output.clear();
+    return readDecoded(filename, [&output](std::span<const char> chunk) {
+        output.append(chunk.data(), chunk.size());
+        return true;
+    });
+}
+
+bool CompressingDriver::readFileToBuffer(std::string_view filename, std::span<char> buffer, size_t& length) const {
+    length = 0;
+    return readDecoded(filename, [&buffer, &length](std::span<const char> chunk) {
+        if (chunk.size() > buffer.size() - length) {
+            return false;
+        }
+        memcpy(buffer.data() + length, chunk.data(), chunk.size());
+        length += chunk.size();
+        return true;
+    });
+}
+
+bool CompressingDriver::getFileSize(std::string_view filename, size_t& size) const {
+
+    auto reader {_driver->openForReading(filename)};
+    const eStoredFormat format {readFormat(reader.get())};
+
+    if (eStoredFormat::FORMAT_COMPRESSED != format) {
+        return reader and _driver->getFileSize(filename, size);
+    }
+
+    // block headers are enough, payloads are skipped
+    size = 0;
+    char skipBuffer[64];
+    blockHeader_t block {};
+    while (sizeof(block) == reader->read({reinterpret_cast<char*>(&block), sizeof(block)})) {
+        for (size_t skipped = 0; skipped < block.storedLength;) {
+            const size_t toSkip {std::min(sizeof(skipBuffer), block.storedLength - skipped)};
+            if (toSkip != reader->read({skipBuffer, toSkip})) {
+                return false;
+            }
+            skipped += toSkip;
+        }
+        size += block.rawLength;
+    }
+    return true;
+}
+
+std::string CompressingDriver::getFileMd5(std::string_view filename) const {
+    return getFileDigest(filename, eDigestType::DIGEST_MD5);
+}
+
+std::string CompressingDriver::getFileDigest(std::string_view filename, const eDigestType type) const {
+    Digest digest {type};
+    const bool read {readDecoded(filename, [&digest](std::span<const char> chunk) {
+        digest.update(chunk);
+        return true;
+    })};
+    return read ? digest.finish() : "";
+}
+
+fileReader_t CompressingDriver::openForReading(std::string_view filename) const {
+    auto stored {_driver->openForReading(filename)};
+    if (!stored) {
+        return nullptr;
+    }
+    if (eStoredFormat::FORMAT_COMPRESSED != readFormat(stored.get())) {
+        return _driver->openForReading(filename);
+    }
+    return std::make_unique<DecodingFileReader>(std::move(stored), *this, filename);
+}
+
+fileWriter_t CompressingDriver::openForWriting(std::string_view filename, const eWriteMode mode) const {
+
+    if (eWriteMode::WRITE_OVERWRITE == mode) {
+        // positional writes can't be applied to compressed stream in place, callers fall back to full save
+        return nullptr;
+    }
+
+    eStoredFormat format {eStoredFormat::FORMAT_MISSING};
+    if (eWriteMode::WRITE_APPEND == mode) {
+        auto reader {_driver->openForReading(filename)};
+        format = readFormat(reader.get());
+    }
+    if (eStoredFormat::FORMAT_PLAIN == format and false == migrateToCompressed(filename)) {
+        return nullptr;
+    }
+
+    const bool isNewFile {eStoredFormat::FORMAT_MISSING == format};
+    auto writer {_driver->openForWriting(filename, isNewFile ? eWriteMode::WRITE_TRUNCATE : eWriteMode::WRITE_APPEND)};
+    if (!writer) {
+        return nullptr;
+    }
+    return std::make_unique<CompressingFileWriter>(std::move(writer), *this, isNewFile);
+}
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include "sdkconfig.h"
+#include "Digest.hpp"
+#include "esp_rom_crc.h"
+#include "esp_idf_version.h"
+#include <string.h>
+#include <assert.h>
+#include <algorithm>
+
+static const uint32_t xxhPrime1 {2654435761U};
+static const uint32_t xxhPrime2 {2246822519U};
+static const uint32_t xxhPrime3 {3266489917U};
+static const uint32_t xxhPrime4 {668265263U};
+static const uint32_t xxhPrime5 {374761393U};
+
+// bump when layout of saved state changes
+static const uint8_t digestStateVersion {1};
+
+static inline uint32_t rotl32(const uint32_t value, const uint8_t shift) {
+    return (value << shift) | (value >> (32 - shift));
+}
+
+static inline uint32_t readLE32(const uint8_t* ptr) {
+    return static_cast<uint32_t>(ptr[0]) | (static_cast<uint32_t>(ptr[1]) << 8) |
+        (static_cast<uint32_t>(ptr[2]) << 16) | (static_cast<uint32_t>(ptr[3]) << 24);
+}
+
+static inline uint32_t readBE32(const uint8_t* ptr) {
+    return (static_cast<uint32_t>(ptr[0]) << 24) | (static_cast<uint32_t>(ptr[1]) << 16) |
+        (static_cast<uint32_t>(ptr[2]) << 8) | static_cast<uint32_t>(ptr[3]);
+}
+
+static inline uint32_t xxh32Round(const uint32_t acc, const uint32_t input) {
+    return rotl32(acc + input * xxhPrime2, 13) * xxhPrime1;
+}
+
+static void xxh32Stripe(xxh32State& state, const uint8_t* stripe) {
+    for (uint8_t i = 0; i < 4; ++i) {
+        state.acc[i] = xxh32Round(state.acc[i], readLE32(stripe + 4 * i));
+    }
+}
+
+static void xxh32Update(xxh32State& state, const uint8_t* data, size_t length) {
+
+    state.totalLength += length;
+
+    if (state.bufferedBytes + length < sizeof(state.buffer)) {
+        memcpy(state.buffer + state.bufferedBytes, data, length);
+        state.bufferedBytes += length;
+        return;
+    }
+
+    if (state.bufferedBytes) {
+        const size_t toFill {sizeof(state.buffer) - state.bufferedBytes};
+        memcpy(state.buffer + state.bufferedBytes, data, toFill);
+        xxh32Stripe(state, state.buffer);
+        data += toFill;
+        length -= toFill;
+        state.bufferedBytes = 0;
+    }
+
+    while (length >= sizeof(state.buffer)) {
+        xxh32Stripe(state, data);
+        data += sizeof(state.buffer);
+        length -= sizeof(state.buffer);
+    }
+
+    memcpy(state.buffer, data, length);
+    state.bufferedBytes = length;
+}
+
+static uint32_t xxh32Finish(const xxh32State& state) {
+
+    uint32_t hash {};
+
+    if (state.totalLength >= sizeof(state.buffer)) {
+        hash = rotl32(state.acc[0], 1) + rotl32(state.acc[1], 7) + rotl32(state.acc[2], 12) + rotl32(state.acc[3], 18);
+    }
+    else {
+        hash = state.acc[2] + xxhPrime5;
+    }
+    hash += state.totalLength;
+
+    const uint8_t* ptr {state.buffer};
+    const uint8_t* const end {state.buffer + state.bufferedBytes};
+
+    while (ptr + 4 <= end) {
+        hash = rotl32(hash + readLE32(ptr) * xxhPrime3, 17) * xxhPrime4;
+        ptr += 4;
+    }
+    while (ptr < end) {
+        hash = rotl32(hash + (*ptr) * xxhPrime5, 11) * xxhPrime1;
+        ++ptr;
+    }
+
+    hash ^= hash >> 15;
+    hash *= xxhPrime2;
+    hash ^= hash >> 13;
+    hash *= xxhPrime3;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static std::string toHexString(const uint8_t* bytes, const size_t length) {
+    static const char* const hexChars {"0123456789abcdef"};
+    std::string ret(2 * length, '\0');
+    for (size_t i = 0; i < length; ++i) {
+        ret[2 * i] = hexChars[bytes[i] >> 4];
+        ret[2 * i + 1] = hexChars[bytes[i] & 0x0F];
+    }
+    return ret;
+}
+
+static std::string toHexString(const uint32_t value) {
+    const uint8_t bytes[] {
+        static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+        static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)
+    };
+    return toHexString(bytes, sizeof(bytes));
+}
+
+static bool fromHexString(const std::string& hex, uint8_t* bytes, const size_t length) {
+
+    if (hex.length() != 2 * length) {
+        return false;
+    }
+
+    auto nibble = [](const char c) -> int {
+        if (c >= '0' and c <= '9') return c - '0';
+        if (c >= 'a' and c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' and c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    for (size_t i = 0; i < length; ++i) {
+        const int high {nibble(hex[2 * i])};
+        const int low {nibble(hex[2 * i + 1])};
+        if (high < 0 or low < 0) {
+            return false;
+        }
+        bytes[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+    return true;
+}
+
+Digest::Digest(const eDigestType type) : _type{type} {
+
+    switch (_type) {
+        case eDigestType::DIGEST_MD5:
+            mbedtls_md5_init(&_ctx.md5);
+            mbedtls_md5_starts(&_ctx.md5);
+        break;
+
+        case eDigestType::DIGEST_CRC32:
+            _ctx.crc32 = 0;
+        break;
+
+        case eDigestType::DIGEST_XXHASH32:
+            memset(&_ctx.xxh32, 0, sizeof(_ctx.xxh32));
+            _ctx.xxh32.acc[0] = xxhPrime1 + xxhPrime2;
+            _ctx.xxh32.acc[1] = xxhPrime2;
+            _ctx.xxh32.acc[2] = 0;
+            _ctx.xxh32.acc[3] = 0 - xxhPrime1;
+        break;
+
+        default:
+            assert(false);
+        break;
+    }
+}
+
+Digest::~Digest() {
+    if (eDigestType::DIGEST_MD5 == _type) {
+        mbedtls_md5_free(&_ctx.md5);
+    }
+}
+
+void Digest::update(std::span<const char> data) {
+
+    const uint8_t* const bytes {reinterpret_cast<const uint8_t*>(data.data())};
+
+    switch (_type) {
+        case eDigestType::DIGEST_MD5:
+            mbedtls_md5_update(&_ctx.md5, bytes, data.size());
+        break;
+
+        case eDigestType::DIGEST_CRC32:
+            _ctx.crc32 = esp_rom_crc32_le(_ctx.crc32, bytes, data.size());
+        break;
+
+        case eDigestType::DIGEST_XXHASH32:
+            xxh32Update(_ctx.xxh32, bytes, data.size());
+        break;
+
+        default:
+            assert(false);
+        break;
+    }
+}
+
+bool Digest::update(IFileReader& reader) {
+    return update(reader, reader.size());
+}
+
+bool Digest::update(IFileReader& reader, size_t length) {
+
+    char chunk[FILE_STREAM_DEFAULT_CHUNK_SIZE];
+    size_t remaining {length};
+
+    while (remaining) {
+        const size_t bytesRead {reader.read({chunk, std::min(sizeof(chunk), remaining)})};
+        if (!bytesRead) {
+            return false;
+        }
+        update({chunk, bytesRead});
+        remaining -= bytesRead < remaining ? bytesRead : remaining;
+    }
+    return true;
+}
+
+std::string Digest::finish() {
+
+    switch (_type) {
+        case eDigestType::DIGEST_MD5: {
+            uint8_t md5[16] {};
+            mbedtls_md5_finish(&_ctx.md5, md5);
+            return toHexString(md5, sizeof(md5));
+        }
+
+        case eDigestType::DIGEST_CRC32:
+            return toHexString(_ctx.crc32);
+
+        case eDigestType::DIGEST_XXHASH32:
+            return toHexString(xxh32Finish(_ctx.xxh32));
+
+        default:
+            assert(false);
+        break;
+    }
+    return "";
+}
+
+size_t Digest::stateSize() const {
+
+    switch (_type) {
+        case eDigestType::DIGEST_MD5:
+            return sizeof(_ctx.md5);
+
+        case eDigestType::DIGEST_CRC32:
+            return sizeof(_ctx.crc32);
+
+        case eDigestType::DIGEST_XXHASH32:
+            return sizeof(_ctx.xxh32);
+
+        default:
+            assert(false);
+        break;
+    }
+    return 0;
+}
+
+uint32_t Digest::stateLayoutTag() const {
+
+    // md5 context is a raw copy of mbedtls or ROM implementation, its layout may change with an OTA update
+    uint32_t implementation {0};
+    if (eDigestType::DIGEST_MD5 == _type) {
+#if CONFIG_MBEDTLS_ROM_MD5
+        implementation = 0x80;
+#endif
+        implementation |= ((ESP_IDF_VERSION_MAJOR & 0x0F) << 3) | (ESP_IDF_VERSION_MINOR & 0x07);
+    }
+    return (static_cast<uint32_t>(digestStateVersion) << 24) | (static_cast<uint32_t>(_type) << 20)
+        | (implementation << 12) | (stateSize() & 0x0FFF);
+}
+
+std::string Digest::saveState() const {
+    return toHexString(stateLayoutTag()).append(toHexString(reinterpret_cast<const uint8_t*>(&_ctx), stateSize()));
+}
+
+bool Digest::restoreState(const std::string& state) {
+
+    uint8_t tag[sizeof(uint32_t)] {};
+    uint8_t restored[sizeof(_ctx)] {};
+    const size_t tagLength {2 * sizeof(tag)};
+
+    // state of other build or of untagged older format, caller rehashes data
+    if (state.length() < tagLength or false == fromHexString(state.substr(0, tagLength), tag, sizeof(tag))
+        or readBE32(tag) != stateLayoutTag()
+        or false == fromHexString(state.substr(tagLength), restored, stateSize())) {
+        return false;
+    }
+
+    memcpy(&_ctx, restored, stateSize());
+    return true;
+}
+
+std::string Digest::ofString(std::string_view content, const eDigestType type) {
+    Digest digest{type};
+    digest.update(content);
+    return digest.finish();
+}
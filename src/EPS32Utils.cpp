@@ -3,6 +3,30 @@
 #include "esp_system.h"
 #include "esp_mac.h"
 #include "esp_timer.h"
+#include "esp_log.h"
+#include "mutex.hpp"
+#include "mutex_locker.hpp"
+#include <map>
+
+static const char* const TAG {"ESP32Utils"};
+
+static Mutex& rebootHooksMutex() {
+    static Mutex mutex;
+    return mutex;
+}
+
+static std::map<uint32_t, ESP32Utils::rebootHook_t>& rebootHooks() {
+    static std::map<uint32_t, ESP32Utils::rebootHook_t> hooks;
+    return hooks;
+}
+
+static void runRebootHooks() {
+    // hooks run under the lock, removeRebootHook can't return while its hook is still running
+    MutexLocker locker{rebootHooksMutex()};
+    for (const auto& [id, hook] : rebootHooks()) {
+        hook();
+    }
+}
 
 void ESP32Utils::reboot() {
     esp_restart();
@@ -22,4 +46,19 @@ esp_reset_reason_t ESP32Utils::rebootReason() {
 uint32_t ESP32Utils::millis() {
     static const uint64_t msFactor {1000ULL};
     return static_cast<uint32_t>(esp_timer_get_time()/msFactor);
+}
+
+uint32_t ESP32Utils::addRebootHook(rebootHook_t hook) {
+    static uint32_t lastId {0};
+    MutexLocker locker{rebootHooksMutex()};
+    if (0 == lastId and ESP_OK != esp_register_shutdown_handler(runRebootHooks)) {
+        ESP_LOGE(TAG, "failed to register shutdown handler");
+    }
+    rebootHooks()[++lastId] = hook;
+    return lastId;
+}
+
+void ESP32Utils::removeRebootHook(const uint32_t id) {
+    MutexLocker locker{rebootHooksMutex()};
+    rebootHooks().erase(id);
 }
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "ESP32HttpClient.hpp"
+#include "ESP32Utils.hpp"
+#include "HttpUtils.hpp"
+#include "StringUtils.hpp"
 #include "esp_log.h"
 #include "esp_crt_bundle.h"
 #include "esp_tls.h"
@@ -30,12 +33,16 @@ esp_err_t ESP32HttpClient::httpClientEventHandler(esp_http_client_event_t *evt)
 
         case HTTP_EVENT_ON_HEADER:
             ESP_LOGI(TAG, "HTTP_EVENT_ON_HEADER: key = %s, value = %s", evt->header_key, evt->header_value);
-            req->setHeader(evt->header_key, evt->header_value);
+            if (req) {
+                req->setHeader(evt->header_key, evt->header_value);
+            }
         break;
         
         case HTTP_EVENT_ON_DATA:
             ESP_LOGI(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-            req->response()->body.append((char*)evt->data, evt->data_len);
+            if (req) {
+                req->response()->body.append((char*)evt->data, evt->data_len);
+            }
         break;
 
         case HTTP_EVENT_ON_FINISH:
@@ -79,13 +86,54 @@ bool ESP32HttpClient::POST (HttpRequest& req) {
 }
 
 void ESP32HttpClient::setCertificate(const char* const cert, const size_t length) {
+    closeAllConnections();
     _cert = cert;
     _certLength = length;
 }
 
+std::string ESP32HttpClient::connectionKey(const HttpRequest& req) {
+    std::string protocol {};
+    std::string host {};
+    HttpUtils::getProtocolFromUrl(req.url(), protocol);
+    HttpUtils::getHostFromUrl(req.url(), host);
+    return StringUtils::format("%s://%s|%u", protocol.c_str(), host.c_str(), (unsigned)req.port());
+}
+
+std::string ESP32HttpClient::credentialsOf(const HttpRequest& req) {
+    return req.username() + '\n' + req.password() + '\n' + std::to_string(req.authType());
+}
+
 bool ESP32HttpClient::initClient(HttpRequest& req) {
 
     resetClient();
+    _clientKey.clear();
+    _clientReused = false;
+
+    const bool keepConnection {req.keepConnection()};
+    const std::string key {keepConnection ? connectionKey(req) : std::string{}};
+
+    if (keepConnection) {
+        auto found {_connections.find(key)};
+        if (_connections.end() != found) {
+            if (credentialsOf(req) == found->second.credentials and true == reuseClient(req, found->second)) {
+                ++_stats.connectionsReused;
+                _clientKey = key;
+                _clientReused = true;
+                return true;
+            }
+            dropConnection(key);
+        }
+
+        if (_connections.size() >= HTTP_CLIENT_MAX_CONNECTIONS) {
+            auto lru {_connections.begin()};
+            for (auto it = _connections.begin(); it != _connections.end(); ++it) {
+                if (it->second.lastUsedMs < lru->second.lastUsedMs) {
+                    lru = it;
+                }
+            }
+            dropConnection(lru->first);
+        }
+    }
 
     const std::string username{req.username()};
     const std::string password{req.password()};
@@ -114,6 +162,35 @@ bool ESP32HttpClient::initClient(HttpRequest& req) {
     if (!_client)
         return false;
 
+    ++_stats.connectionsOpened;
+    if (keepConnection) {
+        connection_t& connection {_connections[key] = connection_t{_client, credentialsOf(req), {}, ESP32Utils::millis(), false}};
+        _clientKey = key;
+        applyHeaders(req, &connection.headers);
+    }
+    else {
+        applyHeaders(req, nullptr);
+    }
+
+    return true;
+}
+
+bool ESP32HttpClient::reuseClient(HttpRequest& req, connection_t& connection) {
+
+    // url of the same host keeps socket open, only path and query are parsed again
+    if (ESP_OK != esp_http_client_set_url(connection.handle, req.url().c_str())
+        or ESP_OK != esp_http_client_set_timeout_ms(connection.handle, (int)(req.timeoutMs()))
+        or ESP_OK != esp_http_client_set_user_data(connection.handle, &req)) {
+        return false;
+    }
+
+    _client = connection.handle;
+    applyHeaders(req, &connection.headers);
+    return true;
+}
+
+void ESP32HttpClient::applyHeaders(HttpRequest& req, std::vector<std::string>* previous) {
+
     if (true == req.keepConnection()) {
         req.setHeader(CONNECTION_HEADER, "keep-alive");
     }
@@ -122,7 +199,72 @@ bool ESP32HttpClient::initClient(HttpRequest& req) {
         esp_http_client_set_header(_client, header.first.c_str(), header.second.c_str());
     }
 
-    return true;
+    if (nullptr == previous) {
+        return;
+    }
+
+    // headers stay in the handle between requests, the ones this request does not set are removed
+    for (const auto& name : *previous) {
+        if (0 == req.headers().count(name)) {
+            esp_http_client_delete_header(_client, name.c_str());
+        }
+    }
+    previous->clear();
+    for (auto &header : req.headers()) {
+        previous->push_back(header.first);
+    }
+}
+
+void ESP32HttpClient::releaseClient(const bool failed) {
+
+    if (_clientKey.empty()) {
+        resetClient();
+        return;
+    }
+
+    if (failed) {
+        dropConnection(_clientKey);
+    }
+    else {
+        connection_t& connection {_connections[_clientKey]};
+        esp_http_client_set_user_data(connection.handle, nullptr);
+        connection.lastUsedMs = ESP32Utils::millis();
+    }
+    _client = nullptr;
+    _clientKey.clear();
+}
+
+void ESP32HttpClient::dropConnection(const std::string& key) {
+
+    auto found {_connections.find(key)};
+    if (_connections.end() == found) {
+        return;
+    }
+    if (_client == found->second.handle) {
+        _client = nullptr;
+    }
+    esp_http_client_cleanup(found->second.handle);
+    _connections.erase(found);
+    ++_stats.connectionsDropped;
+}
+
+void ESP32HttpClient::closeIdleConnections() {
+
+    const uint32_t now {ESP32Utils::millis()};
+    for (auto it = _connections.begin(); it != _connections.end();) {
+        const std::string key {it->first};
+        const bool idle {now - it->second.lastUsedMs >= _idleTimeoutMs};
+        ++it;
+        if (idle) {
+            dropConnection(key);
+        }
+    }
+}
+
+void ESP32HttpClient::closeAllConnections() {
+    while (false == _connections.empty()) {
+        dropConnection(_connections.begin()->first);
+    }
 }
 
 const char* ESP32HttpClient::reqStatusString(const eRequestStatus val) const{
@@ -141,7 +283,20 @@ const char* ESP32HttpClient::reqStatusString(const eRequestStatus val) const{
     }
 }
 
+// typical for kept socket closed by server, nothing came back on it
+// header fetch fails after whole request was sent, server may have acted on it, so only GET is repeated then
+// connect and write errors mean request never arrived complete, POST can't have been processed
+static bool isSafeToRetry(const esp_err_t err, const esp_http_client_method_t method) {
+    if (ESP_ERR_HTTP_CONNECT == err or ESP_ERR_HTTP_WRITE_DATA == err) {
+        return true;
+    }
+    return ESP_ERR_HTTP_FETCH_HEADER == err and esp_http_client_method_t::HTTP_METHOD_GET == method;
+}
+
 bool ESP32HttpClient::performRequest(HttpRequest& req, const esp_http_client_method_t method) {
+    ++_stats.requests;
+    closeIdleConnections();
+
     if(!initClient(req)) {
         req.set_status(eRequestStatus::REQUEST_STATUS_FAILED);
         return false;
@@ -149,19 +304,25 @@ bool ESP32HttpClient::performRequest(HttpRequest& req, const esp_http_client_met
 
     req.set_status(eRequestStatus::REQUEST_STATUS_PENDING);
 
-    ESP_ERROR_CHECK(esp_http_client_set_method(_client, method));
-
-    if(req.body().length()) {
-        ESP_ERROR_CHECK(esp_http_client_set_post_field(_client, req.body().c_str(), req.body().length()));
-    }
-
     if (!req.response()) {
         req.createResponse();
     }
     else {
         ESP_LOGE(TAG, "repsponse already exists!");
     }
-    esp_err_t err = esp_http_client_perform(_client);
+    esp_err_t err = perform(req, method);
+
+    if (ESP_OK != err and _clientReused and isSafeToRetry(err, method) and req.response()->body.empty()) {
+        ESP_LOGW(TAG, "kept connection failed before response, retrying on new one");
+        ++_stats.staleRetries;
+        releaseClient(true);
+        if (!initClient(req)) {
+            req.set_status(eRequestStatus::REQUEST_STATUS_FAILED);
+            return false;
+        }
+        req.createResponse();
+        err = perform(req, method);
+    }
 
     req.response()->code = (eHttpCode) esp_http_client_get_status_code(_client);
     if (err == ESP_OK) {
@@ -172,17 +333,61 @@ bool ESP32HttpClient::performRequest(HttpRequest& req, const esp_http_client_met
     else {
         req.set_status(eRequestStatus::REQUEST_STATUS_FAILED);
         ESP_LOGE(TAG, "request failed!");
+        releaseClient(true);
         return false;
     }
+    releaseClient(false);
+    return true;
+}
+
+esp_err_t ESP32HttpClient::perform(HttpRequest& req, const esp_http_client_method_t method) {
+
+    ESP_ERROR_CHECK(esp_http_client_set_method(_client, method));
+
+    if (false == applyBody(req)) {
+        ESP_LOGE(TAG, "failed to set request body");
+        return ESP_FAIL;
+    }
+    return esp_http_client_perform(_client);
+}
+
+bool ESP32HttpClient::applyBody(HttpRequest& req) {
+
+    bool* const hasBody {_clientKey.empty() ? nullptr : &_connections[_clientKey].hasBody};
+
+    if (req.body().length()) {
+        if (ESP_OK != esp_http_client_set_post_field(_client, req.body().c_str(), req.body().length())) {
+            return false;
+        }
+        if (hasBody) {
+            *hasBody = true;
+        }
+        return true;
+    }
+
+    // new handle has no body, reused one is cleared only if previous request left one there
+    if (nullptr == hasBody or false == *hasBody) {
+        return true;
+    }
+    // NOT_FOUND comes from removing content type header which was not set, body is cleared anyway
+    const esp_err_t err {esp_http_client_set_post_field(_client, NULL, 0)};
+    if (ESP_OK != err and ESP_ERR_NOT_FOUND != err) {
+        return false;
+    }
+    *hasBody = false;
     return true;
 }
 
 ESP32HttpClient::~ESP32HttpClient() {
+    closeAllConnections();
     resetClient();
     ESP_LOGI(TAG, "~ESP32HttpClient()");
 }
 
 void ESP32HttpClient::resetClient() {
-    esp_http_client_cleanup(_client);
+    // handles of kept connections are cleaned up by dropConnection
+    if (_client and _clientKey.empty()) {
+        esp_http_client_cleanup(_client);
+    }
     _client = nullptr;
 }
\ No newline at end of file
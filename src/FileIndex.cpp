@@ -0,0 +1,215 @@
+#include "FileIndex.hpp"
+#include "mutex_locker.hpp"
+
+// walks the live map, iterator is reused only while no entry changed since previous step
+// otherwise lookup continues after the last returned name, entries removed meanwhile are skipped
+struct FileIndex::IndexDirectoryReader : IDirectoryReader {
+    IndexDirectoryReader(const FileIndex& index, std::string&& prefix)
+        :   _index{index}, _prefix{std::move(prefix)} {}
+    const char* next() override {
+        MutexLocker locker{_index._mutex};
+        if (_ended) {
+            return nullptr;
+        }
+        if (false == _started) {
+            _position = _index._files.lower_bound(_prefix);
+            _started = true;
+        }
+        else if (_generation == _index._generation) {
+            ++_position;
+        }
+        else {
+            _position = _index._files.upper_bound(_name);
+        }
+        _generation = _index._generation;
+        if (_index._files.end() == _position or 0 != _position->first.compare(0, _prefix.length(), _prefix)) {
+            _ended = true;
+            return nullptr;
+        }
+        // returned pointer has to outlive the lock, entry may be removed before caller is done with it
+        _name = _position->first;
+        return _name.c_str() + _prefix.length();
+    }
+private:
+    const FileIndex& _index;
+    const std::string _prefix;
+    std::map<std::string, fileMeta_t, std::less<>>::const_iterator _position;
+    std::string _name;
+    uint32_t _generation{};
+    bool _started{false};
+    bool _ended{false};
+};
+
+void FileIndex::clear() {
+    MutexLocker locker{_mutex};
+    _files.clear();
+    _lastRemoval = ++_generation;
+}
+
+uint32_t FileIndex::currentGeneration() const {
+    MutexLocker locker{_mutex};
+    return _generation;
+}
+
+void FileIndex::replaceWith(FileIndex&& scanned, const uint32_t scanStart) {
+
+    // scanned index is private to the caller, only this one is shared
+    MutexLocker locker{_mutex};
+
+    for (auto& [filename, meta] : scanned._files) {
+        const auto live {_files.find(filename)};
+        if (_files.end() != live and live->second.generation > scanStart) {
+            meta = std::move(live->second);
+        }
+        else if (_files.end() == live and _lastRemoval > scanStart) {
+            // scan may have listed it before it was removed, dropped below
+            meta.generation = 0;
+        }
+        else {
+            meta.generation = ++_generation;
+        }
+    }
+    std::erase_if(scanned._files, [](const auto& file) { return 0 == file.second.generation; });
+
+    // created while directory was being scanned
+    for (auto& [filename, meta] : _files) {
+        if (meta.generation > scanStart) {
+            scanned._files.try_emplace(filename, std::move(meta));
+        }
+    }
+
+    _files.swap(scanned._files);
+    // open directory readers must not step through iterators of the swapped out map
+    ++_generation;
+}
+
+FileIndex::fileMeta_t& FileIndex::entry(std::string_view filename) {
+    auto found {_files.find(filename)};
+    if (_files.end() == found) {
+        found = _files.emplace(std::string{filename}, fileMeta_t{}).first;
+    }
+    return found->second;
+}
+
+void FileIndex::update(std::string_view filename, const size_t size) {
+    MutexLocker locker{_mutex};
+    auto& meta {entry(filename)};
+    meta.size = size;
+    meta.generation = ++_generation;
+    meta.digest.clear();
+}
+
+void FileIndex::grow(std::string_view filename, const size_t bytesAppended) {
+    MutexLocker locker{_mutex};
+    auto found {_files.find(filename)};
+    if (_files.end() == found) {
+        _files.emplace(std::string{filename}, fileMeta_t{bytesAppended, ++_generation, eDigestType::DIGEST_MD5, ""});
+        return;
+    }
+    auto& meta {found->second};
+    if (kUnknownSize != meta.size) {
+        meta.size += bytesAppended;
+    }
+    meta.generation = ++_generation;
+    meta.digest.clear();
+}
+
+void FileIndex::resolveSize(std::string_view filename, const size_t size) {
+    MutexLocker locker{_mutex};
+    auto found {_files.find(filename)};
+    if (_files.end() != found) {
+        found->second.size = size;
+    }
+}
+
+void FileIndex::remove(std::string_view filename) {
+    MutexLocker locker{_mutex};
+    const auto found {_files.find(filename)};
+    if (_files.end() != found) {
+        _files.erase(found);
+        _lastRemoval = ++_generation;
+    }
+}
+
+void FileIndex::rename(std::string_view from, std::string_view to) {
+    MutexLocker locker{_mutex};
+    auto found {_files.find(from)};
+    if (_files.end() == found) {
+        return;
+    }
+    fileMeta_t meta {std::move(found->second)};
+    _files.erase(found);
+    _lastRemoval = ++_generation;
+    meta.generation = ++_generation;
+    entry(to) = std::move(meta);
+}
+
+bool FileIndex::contains(std::string_view filename) const {
+    MutexLocker locker{_mutex};
+    return _files.count(filename);
+}
+
+bool FileIndex::size(std::string_view filename, size_t& size) const {
+    MutexLocker locker{_mutex};
+    const auto found {_files.find(filename)};
+    if (_files.end() == found or kUnknownSize == found->second.size) {
+        return false;
+    }
+    size = found->second.size;
+    return true;
+}
+
+uint32_t FileIndex::generation(std::string_view filename) const {
+    MutexLocker locker{_mutex};
+    const auto found {_files.find(filename)};
+    return _files.end() == found ? 0 : found->second.generation;
+}
+
+bool FileIndex::digest(std::string_view filename, const eDigestType type, std::string& digest) const {
+    MutexLocker locker{_mutex};
+    const auto found {_files.find(filename)};
+    if (_files.end() == found or found->second.digest.empty() or type != found->second.digestType) {
+        return false;
+    }
+    digest = found->second.digest;
+    return true;
+}
+
+void FileIndex::setDigest(std::string_view filename, const eDigestType type, const std::string& digest, const uint32_t generation) {
+    MutexLocker locker{_mutex};
+    auto found {_files.find(filename)};
+    if (_files.end() == found or generation != found->second.generation) {
+        return;
+    }
+    found->second.digestType = type;
+    found->second.digest = digest;
+}
+
+std::string FileIndex::directoryPrefix(const std::string& path) {
+    std::string prefix {path};
+    if (prefix.empty() or '/' != prefix.back()) {
+        prefix.push_back('/');
+    }
+    return prefix;
+}
+
+template<typename visitor_t>
+void FileIndex::forEachInDirectory(const std::string& path, visitor_t visitor) const {
+
+    const std::string prefix {directoryPrefix(path)};
+
+    for (auto it = _files.lower_bound(prefix); it != _files.end() and 0 == it->first.compare(0, prefix.length(), prefix); ++it) {
+        visitor(it->first.c_str() + prefix.length());
+    }
+}
+
+uint32_t FileIndex::count(const std::string& path) const {
+    MutexLocker locker{_mutex};
+    uint32_t ret {0};
+    forEachInDirectory(path, [&ret](const char* const) { ++ret; });
+    return ret;
+}
+
+directoryReader_t FileIndex::openDirectory(const std::string& path) const {
+    return std::make_unique<IndexDirectoryReader>(*this, directoryPrefix(path));
+}
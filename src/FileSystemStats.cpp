@@ -0,0 +1,68 @@
+#include "FileSystemStats.hpp"
+#include "ESP32Utils.hpp"
+#include "mutex_locker.hpp"
+
+static constexpr uint32_t msPerDay {24UL * 60UL * 60UL * 1000UL};
+
+FileSystemStats::FileSystemStats()
+    :   _startMs{ESP32Utils::millis()} {
+}
+
+void FileSystemStats::record(const eFsOperation op, const uint64_t bytes, const uint32_t us, const bool ok) {
+
+    MutexLocker locker{_mutex};
+    fsOperationStats_t& stats {_stats.operations[static_cast<size_t>(op)]};
+    ++stats.calls;
+    stats.latency.record(us);
+
+    if (false == ok) {
+        ++stats.failures;
+        return;
+    }
+    stats.bytes += bytes;
+    if (eFsOperation::FS_OP_WRITE == op or eFsOperation::FS_OP_APPEND == op) {
+        _bytesWritten += bytes;
+    }
+}
+
+fsStats_t FileSystemStats::snapshot() const {
+    MutexLocker locker{_mutex};
+    fsStats_t ret {_stats};
+    ret.periodMs = ESP32Utils::millis() - _startMs;
+    return ret;
+}
+
+void FileSystemStats::reset() {
+    MutexLocker locker{_mutex};
+    _stats = fsStats_t{};
+    _bytesWritten = 0;
+    _startMs = ESP32Utils::millis();
+}
+
+flashWearEstimate_t FileSystemStats::wearEstimate(const size_t partitionBytes, const uint32_t ratedEraseCycles) const {
+
+    MutexLocker locker{_mutex};
+    flashWearEstimate_t ret {};
+    ret.bytesWritten = _bytesWritten;
+    ret.partitionBytes = partitionBytes;
+
+    if (0 == partitionBytes or 0 == ratedEraseCycles) {
+        return ret;
+    }
+
+    // every block has to be erased once per partition size written, metadata and gc overhead not included
+    ret.eraseCycles = static_cast<float>(_bytesWritten) / partitionBytes;
+    ret.budgetUsedPercent = 100.0F * ret.eraseCycles / ratedEraseCycles;
+
+    const uint32_t periodMs {ESP32Utils::millis() - _startMs};
+    if (0 == periodMs or 0 == _bytesWritten) {
+        return ret;
+    }
+
+    ret.bytesPerDay = _bytesWritten * msPerDay / periodMs;
+    const float cyclesPerDay {static_cast<float>(ret.bytesPerDay) / partitionBytes};
+    const float cyclesLeft {static_cast<float>(ratedEraseCycles) - ret.eraseCycles};
+    const float daysLeft {cyclesLeft > 0.0F ? cyclesLeft / cyclesPerDay : 0.0F};
+    ret.daysLeft = daysLeft < static_cast<float>(UINT32_MAX) ? static_cast<uint32_t>(daysLeft) : UINT32_MAX;
+    return ret;
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "LatencyHistogram.hpp"
+#include <string.h>
+
+static size_t bucketOf(const uint32_t us) {
+    size_t bucket {0};
+    for (uint32_t value = us; value and bucket < LATENCY_HISTOGRAM_BUCKETS - 1; value >>= 1) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+void LatencyHistogram::record(const uint32_t us) {
+    ++_buckets[bucketOf(us)];
+    ++_count;
+    if (us > _max) {
+        _max = us;
+    }
+}
+
+void LatencyHistogram::reset() {
+    memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+    _max = 0;
+}
+
+uint32_t LatencyHistogram::percentile(const float percent) const {
+
+    if (0 == _count) {
+        return 0;
+    }
+
+    const uint64_t rank {static_cast<uint64_t>(percent * _count / 100.0F + 0.5F)};
+    uint64_t seen {0};
+
+    for (size_t bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS; ++bucket) {
+        seen += _buckets[bucket];
+        if (seen >= rank and 0 != seen) {
+            const uint32_t upperBound {bucket ? static_cast<uint32_t>((1ULL << bucket) - 1) : 0};
+            return upperBound < _max ? upperBound : _max;
+        }
+    }
+    return _max;
+}
+
+latencySummary_t LatencyHistogram::summary() const {
+    return latencySummary_t{_count, percentile(50.0F), percentile(99.0F), _max};
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "sdkconfig.h"
+#if CONFIG_ENABLE_LITTLEFS_DRIVER
+#include "LittleFS_IDFDriver.hpp"
+#include "StdioFileStream.hpp"
+#include "esp_log.h"
+#include "unistd.h"
+#include <dirent.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+static const char* const TAG {"LittleFS_IDFDriver"};
+
+LittleFS_IDFDriver::LittleFS_IDFDriver(const char* const path, const char* const partitionLabel) {
+    _conf.base_path = path;
+    _conf.partition_label = partitionLabel;
+    _conf.format_if_mount_failed = true;
+    initialize();
+}
+
+LittleFS_IDFDriver::~LittleFS_IDFDriver() {
+    esp_vfs_littlefs_unregister(_conf.partition_label);
+}
+
+void LittleFS_IDFDriver::initialize() {
+    _isReady = false;
+    // littlefs is power-loss resilient, mount replays metadata log so there is no separate check
+    const esp_err_t err = esp_vfs_littlefs_register(&_conf);
+
+    if (err != ESP_OK) {
+        if (err == ESP_FAIL) {
+            ESP_LOGE(TAG, "Failed to mount or format filesystem");
+        } else if (err == ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "Failed to find LittleFS partition");
+        } else {
+            ESP_LOGE(TAG, "Failed to initialize LittleFS (%s)", esp_err_to_name(err));
+        }
+        return;
+    }
+    _isReady = true;
+}
+
+bool LittleFS_IDFDriver::format() const {
+    return ESP_OK == esp_littlefs_format(_conf.partition_label);
+}
+
+float LittleFS_IDFDriver::usagePercent() const  {
+
+    size_t totalBytes {};
+    size_t usedBytes {};
+
+    if (ESP_OK != esp_littlefs_info(_conf.partition_label, &totalBytes, &usedBytes))
+        return 0.0;
+
+    return 100.0F * static_cast<float>(usedBytes) / totalBytes;
+}
+
+size_t LittleFS_IDFDriver::totalBytes() const {
+
+    size_t totalBytes {};
+    size_t usedBytes {};
+
+    if (ESP_OK != esp_littlefs_info(_conf.partition_label, &totalBytes, &usedBytes))
+        return 0;
+
+    return totalBytes;
+}
+
+fileReader_t LittleFS_IDFDriver::doOpenForReading(std::string_view filename) const {
+
+    const FilePath path {filename};
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file) {
+        ESP_LOGD(TAG, "Failed to open file for reading: %s", path.c_str());
+        return nullptr;
+    }
+    return std::make_unique<StdioFileReader>(file);
+}
+
+fileWriter_t LittleFS_IDFDriver::doOpenForWriting(std::string_view filename, const eWriteMode mode) const {
+
+    const FilePath path {filename};
+    if (eWriteMode::WRITE_OVERWRITE != mode and false == makeParentDirectories(path, strlen(_conf.base_path))) {
+        ESP_LOGE(TAG, "Failed to create directories for: %s", path.c_str());
+        return nullptr;
+    }
+
+    FILE* file = fopen(path.c_str(), openModeString(mode));
+    if (!file) {
+        ESP_LOGE(TAG, "Failed to open file for writing: %s", path.c_str());
+        return nullptr;
+    }
+    return std::make_unique<StdioFileWriter>(file);
+}
+
+directoryReader_t LittleFS_IDFDriver::openDirectory(const std::string& path) const {
+
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return nullptr;
+    }
+    return std::make_unique<DirentDirectoryReader>(dir);
+}
+
+bool LittleFS_IDFDriver::deleteFile(std::string_view filename) const {
+    return 0 == unlink(FilePath{filename}.c_str()) or ENOENT == errno;
+}
+
+bool LittleFS_IDFDriver::renameFile(std::string_view from, std::string_view to) const {
+    // littlefs replaces destination atomically
+    const FilePath toPath {to};
+    return makeParentDirectories(toPath, strlen(_conf.base_path)) and 0 == rename(FilePath{from}.c_str(), toPath.c_str());
+}
+
+bool LittleFS_IDFDriver::doesFileExist(std::string_view filename) const {
+    struct stat st;
+    return 0 == stat(FilePath{filename}.c_str(), &st) and S_ISREG(st.st_mode);
+}
+
+bool LittleFS_IDFDriver::deleteMany(const std::vector<std::string>& filenames) const {
+    bool ret {true};
+    for (const auto& filename : filenames) {
+        ret = deleteFile(filename) and ret;
+    }
+    return ret;
+}
+
+std::vector<bool> LittleFS_IDFDriver::existsMany(const std::vector<std::string>& filenames) const {
+    std::vector<bool> ret {};
+    ret.reserve(filenames.size());
+    for (const auto& filename : filenames) {
+        ret.push_back(doesFileExist(filename));
+    }
+    return ret;
+}
+
+bool LittleFS_IDFDriver::getFileSize(std::string_view filename, size_t& size) const {
+    struct stat st;
+    if (0 == stat(FilePath{filename}.c_str(), &st) and S_ISREG(st.st_mode)) {
+        size = st.st_size;
+        return true;
+    }
+    return false;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "LzCodec.hpp"
+#include <string.h>
+
+static const size_t minMatch {4};
+static const size_t lastLiterals {5};
+static const size_t matchFindLimit {12};
+static const size_t maxOffset {UINT16_MAX};
+static const uint8_t runMask {15};
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hashOf(const uint8_t* p) {
+    return (read32(p) * 2654435761U) >> (32 - LZ_CODEC_HASH_LOG);
+}
+
+struct outputCursor_t {
+    uint8_t* pos;
+    uint8_t* const end;
+
+    bool put(const uint8_t byte) {
+        if (pos >= end) {
+            return false;
+        }
+        *pos++ = byte;
+        return true;
+    }
+    bool putLength(size_t length) {
+        for (; length >= 255; length -= 255) {
+            if (false == put(255)) {
+                return false;
+            }
+        }
+        return put(static_cast<uint8_t>(length));
+    }
+    bool putBytes(const uint8_t* data, const size_t length) {
+        if (static_cast<size_t>(end - pos) < length) {
+            return false;
+        }
+        memcpy(pos, data, length);
+        pos += length;
+        return true;
+    }
+};
+
+static bool emitSequence(outputCursor_t& out, const uint8_t* literals, const size_t literalsLength, const size_t offset, const size_t matchLength) {
+
+    const size_t matchCode {matchLength ? matchLength - minMatch : 0};
+    uint8_t token = (literalsLength >= runMask ? runMask : literalsLength) << 4;
+    token |= matchCode >= runMask ? runMask : matchCode;
+
+    if (false == out.put(token)
+        or (literalsLength >= runMask and false == out.putLength(literalsLength - runMask))
+        or false == out.putBytes(literals, literalsLength)) {
+        return false;
+    }
+
+    // last sequence carries literals only
+    if (0 == matchLength) {
+        return true;
+    }
+
+    return out.put(offset & 0xFF) and out.put(offset >> 8)
+        and (matchCode < runMask or out.putLength(matchCode - runMask));
+}
+
+size_t LzCodec::compress(std::span<const char> src, std::span<char> dst) {
+
+    const uint8_t* const base {reinterpret_cast<const uint8_t*>(src.data())};
+    const size_t size {src.size()};
+    outputCursor_t out {reinterpret_cast<uint8_t*>(dst.data()), reinterpret_cast<uint8_t*>(dst.data()) + dst.size()};
+
+    size_t anchor {0};
+
+    if (size >= matchFindLimit) {
+        memset(_table, 0, sizeof(_table));
+        const size_t matchLimit {size - lastLiterals};
+
+        for (size_t pos = 1; pos + matchFindLimit <= size;) {
+            const uint32_t hash {hashOf(base + pos)};
+            const size_t candidate {_table[hash]};
+            _table[hash] = static_cast<uint16_t>(pos);
+
+            if (candidate >= pos or pos - candidate > maxOffset or read32(base + candidate) != read32(base + pos)) {
+                ++pos;
+                continue;
+            }
+
+            size_t length {minMatch};
+            while (pos + length < matchLimit and base[candidate + length] == base[pos + length]) {
+                ++length;
+            }
+
+            if (false == emitSequence(out, base + anchor, pos - anchor, pos - candidate, length)) {
+                return 0;
+            }
+            pos += length;
+            anchor = pos;
+        }
+    }
+
+    if (false == emitSequence(out, base + anchor, size - anchor, 0, 0)) {
+        return 0;
+    }
+    return out.pos - reinterpret_cast<uint8_t*>(dst.data());
+}
+
+static bool readLength(const uint8_t*& in, const uint8_t* const end, size_t& length) {
+    uint8_t byte;
+    do {
+        if (in >= end) {
+            return false;
+        }
+        byte = *in++;
+        length += byte;
+    } while (255 == byte);
+    return true;
+}
+
+bool LzCodec::decompress(std::span<const char> src, std::span<char> dst) {
+
+    const uint8_t* in {reinterpret_cast<const uint8_t*>(src.data())};
+    const uint8_t* const inEnd {in + src.size()};
+    uint8_t* const outBegin {reinterpret_cast<uint8_t*>(dst.data())};
+    uint8_t* out {outBegin};
+    uint8_t* const outEnd {out + dst.size()};
+
+    while (in < inEnd) {
+        const uint8_t token {*in++};
+
+        size_t literalsLength {static_cast<size_t>(token >> 4)};
+        if (runMask == literalsLength and false == readLength(in, inEnd, literalsLength)) {
+            return false;
+        }
+        if (static_cast<size_t>(inEnd - in) < literalsLength or static_cast<size_t>(outEnd - out) < literalsLength) {
+            return false;
+        }
+        memcpy(out, in, literalsLength);
+        in += literalsLength;
+        out += literalsLength;
+
+        if (in == inEnd) {
+            break;
+        }
+
+        if (inEnd - in < 2) {
+            return false;
+        }
+        const size_t offset {static_cast<size_t>(in[0] | (in[1] << 8))};
+        in += 2;
+
+        size_t matchLength {static_cast<size_t>(token & runMask)};
+        if (runMask == matchLength and false == readLength(in, inEnd, matchLength)) {
+            return false;
+        }
+        matchLength += minMatch;
+
+        if (0 == offset or static_cast<size_t>(out - outBegin) < offset or static_cast<size_t>(outEnd - out) < matchLength) {
+            return false;
+        }
+        // byte by byte, match may overlap its own output
+        const uint8_t* match {out - offset};
+        for (size_t i = 0; i < matchLength; ++i) {
+            *out++ = *match++;
+        }
+    }
+
+    return out == outEnd;
+}
\ No newline at end of file
@@ -31,38 +31,27 @@ bool NVS::read(const char* const storage, const char* const tag, int64_t& res) {
 }
 
 bool NVS::read(const char* const storage, const char* const tag, string& res) {
+    // reads straight into res, no temporary buffer
+    return NVSSession{storage, true}.read(tag, res);
+}
 
-    bool ret = false;
-    string readRes = "";
-    size_t readLength = 0;
-    
-    if (true == openToRead(storage)) {
-        esp_err_t err = nvs_get_str(_handle, tag, NULL, &readLength);
-        char* charArr = new char[readLength+1];
-        err = nvs_get_str(_handle, tag, charArr, &readLength);
-        switch (err) {
-            case ESP_OK:
-                ret = true;
-                charArr[readLength] = '\0';
-                readRes = string(charArr);
-            break;
-            case ESP_ERR_NVS_NOT_FOUND:
-                DBG_PRINT_TAG(TAG, "The value %s is not initialized yet!", tag);
-            break;
+bool NVS::read(const char* const storage, const char* const tag, span<char> buffer, size_t& length) {
+    return NVSSession{storage, true}.read(tag, buffer, length);
+}
 
-            default :
-                DBG_PRINT_TAG(TAG,"Error (%s) reading!\n", esp_err_to_name(err));
-        }
-        delete[] charArr;
-        nvs_close(_handle);
-    }
+bool NVS::readBlob(const char* const storage, const char* const tag, span<uint8_t> buffer, size_t& length) {
+    return NVSSession{storage, true}.readBlob(tag, buffer, length);
+}
 
-    if (true == ret) {
-        res = readRes;
-    }
-    return ret;
+bool NVS::writeBlob(const char* const storage, const char* const tag, span<const uint8_t> data) {
+    NVSSession session {storage};
+    return session.writeBlob(tag, data) and session.commit();
 }
 
+template<typename T>
+concept storedAsObjectBlob = requires (NVS& nvs, const T& value) { nvs.writeBlob<T>("", "", value); };
+static_assert(false == storedAsObjectBlob<span<uint8_t>>, "byte span must reach span overload of writeBlob");
+
 bool NVS::write(const char* const storage, const char* const tag, const int64_t val) {
     bool ret = false;
 
@@ -0,0 +1,215 @@
+#include "NVSCache.hpp"
+#include "NVSSession.hpp"
+#include "ESP32Utils.hpp"
+#include "mutex_locker.hpp"
+#include <memory>
+#include <type_traits>
+
+#include "ThreadSafeDbg.hpp"
+
+static const char* const TAG {"NVSCache"};
+/// erased key is missing whatever type is asked for
+static const uint8_t allTypesMissing {0xFF};
+
+template<typename T>
+static constexpr uint8_t missingTypeBit() {
+    return std::is_same_v<T, int64_t> ? 0x01 : 0x02;
+}
+
+NVSCache::NVSCache(const nvsCacheConfig_t& config)
+    :   _config{config} {
+    _rebootHookId = ESP32Utils::addRebootHook([this]() { flush(); });
+}
+
+NVSCache::~NVSCache() {
+    ESP32Utils::removeRebootHook(_rebootHookId);
+    flush();
+}
+
+bool NVSCache::read(const char* const storage, const char* const tag, std::string& res) {
+    return doRead(storage, tag, res);
+}
+
+bool NVSCache::read(const char* const storage, const char* const tag, int64_t& res) {
+    return doRead(storage, tag, res);
+}
+
+template<typename T>
+bool NVSCache::doRead(const char* const storage, const char* const tag, T& res) {
+
+    MutexLocker locker{_mutex};
+    flushIfNeeded();
+
+    entry_t* entry {find(storage, tag)};
+    if (entry and std::holds_alternative<T>(entry->value)) {
+        ++_stats.readHits;
+        res = std::get<T>(entry->value);
+        return true;
+    }
+    if (entry and std::holds_alternative<std::monostate>(entry->value) and (entry->missingTypes & missingTypeBit<T>())) {
+        ++_stats.readHits;
+        return false;
+    }
+
+    ++_stats.readMisses;
+    T value {};
+    NVSSession session {storage, true};
+    if (entry and false == std::holds_alternative<std::monostate>(entry->value)) {
+        // key holds another type in cache, NVS keys are typed so this one may still exist in flash
+        // entry keeps the cached value, only one value per key is mirrored
+        if (false == session.read(tag, value)) {
+            return false;
+        }
+        res = std::move(value);
+        return true;
+    }
+    if (nullptr == entry) {
+        entry = &_storages[storage][tag];
+    }
+    if (session.read(tag, value)) {
+        entry->value = value;
+        entry->missingTypes = 0;
+        res = std::move(value);
+        return true;
+    }
+    // remembered as missing for this type only, so next read of it does not go to flash
+    entry->missingTypes |= missingTypeBit<T>();
+    return false;
+}
+
+bool NVSCache::write(const char* const storage, const char* const tag, const int64_t val) {
+    return update(storage, tag, value_t{val});
+}
+
+bool NVSCache::write(const char* const storage, const char* const tag, const char* val) {
+    return update(storage, tag, value_t{std::string(val)});
+}
+
+bool NVSCache::erase(const char* const storage, const char* const tag) {
+    return update(storage, tag, value_t{});
+}
+
+bool NVSCache::update(const char* const storage, const char* const tag, value_t&& value) {
+
+    MutexLocker locker{_mutex};
+    ++_stats.writes;
+
+    const bool erasing {std::holds_alternative<std::monostate>(value)};
+    entry_t* entry {find(storage, tag)};
+    // key missing for one type only may still exist as another one, erase has to reach flash
+    if (entry and entry->value == value and (false == erasing or allTypesMissing == entry->missingTypes)) {
+        // write-through NVS would commit the same value again
+        ++_stats.commitsSaved;
+        return flushIfNeeded();
+    }
+
+    if (nullptr == entry) {
+        entry = &_storages[storage][tag];
+    }
+    entry->value = std::move(value);
+    entry->missingTypes = erasing ? allTypesMissing : 0;
+    entry->dirty = true;
+
+    if (0 == _dirtyChanges) {
+        _firstDirtyMs = ESP32Utils::millis();
+    }
+    ++_dirtyChanges;
+    return flushIfNeeded();
+}
+
+NVSCache::entry_t* NVSCache::find(const char* const storage, const char* const tag) {
+
+    auto entries {_storages.find(storage)};
+    if (_storages.end() == entries) {
+        return nullptr;
+    }
+    auto found {entries->second.find(tag)};
+    return entries->second.end() == found ? nullptr : &found->second;
+}
+
+bool NVSCache::flush() {
+    MutexLocker locker{_mutex};
+    return flushAll();
+}
+
+bool NVSCache::flushExpired() {
+    MutexLocker locker{_mutex};
+    return flushIfNeeded();
+}
+
+bool NVSCache::flushIfNeeded() {
+
+    if (0 == _dirtyChanges) {
+        return true;
+    }
+    if (_dirtyChanges >= _config.maxDirtyChanges or ESP32Utils::millis() - _firstDirtyMs >= _config.flushPeriodMs) {
+        return flushAll();
+    }
+    return true;
+}
+
+bool NVSCache::flushAll() {
+
+    if (0 == _dirtyChanges) {
+        return true;
+    }
+
+    bool ret {true};
+    uint32_t commits {0};
+    ++_stats.flushes;
+
+    for (auto& [storage, entries] : _storages) {
+        // opened on first dirty entry, one commit per namespace
+        std::unique_ptr<NVSSession> session {};
+
+        for (auto& [tag, entry] : entries) {
+            if (false == entry.dirty) {
+                continue;
+            }
+            if (!session) {
+                session = std::make_unique<NVSSession>(storage.c_str());
+            }
+
+            bool written {false};
+            if (const int64_t* const number = std::get_if<int64_t>(&entry.value)) {
+                written = session->write(tag.c_str(), *number);
+            }
+            else if (const std::string* const text = std::get_if<std::string>(&entry.value)) {
+                written = session->write(tag.c_str(), text->c_str());
+            }
+            else {
+                written = session->erase(tag.c_str());
+            }
+            // failed entries stay dirty and are retried on next flush
+            entry.dirty = false == written;
+            ret = written and ret;
+        }
+
+        if (session) {
+            if (session->pendingChanges()) {
+                ++commits;
+            }
+            ret = session->commit() and ret;
+        }
+    }
+
+    if (false == ret) {
+        DBG_PRINT_TAG(TAG, "flush failed, dirty values kept");
+    }
+    // each change since last flush would have been a commit of its own
+    _stats.commits += commits;
+    _stats.commitsSaved += _dirtyChanges > commits ? _dirtyChanges - commits : 0;
+    _dirtyChanges = 0;
+    for (const auto& [storage, entries] : _storages) {
+        for (const auto& [tag, entry] : entries) {
+            _dirtyChanges += entry.dirty;
+        }
+    }
+    _firstDirtyMs = ESP32Utils::millis();
+    return ret;
+}
+
+nvsCacheStats_t NVSCache::stats() const {
+    MutexLocker locker{_mutex};
+    return _stats;
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "NVSSession.hpp"
+
+#include "ThreadSafeDbg.hpp"
+
+static const char* const TAG {"NVSSession"};
+
+NVSSession::NVSSession(const char* const storage, const bool readOnly)
+    :   _readOnly{readOnly} {
+
+    const esp_err_t err {nvs_open(storage, readOnly ? NVS_READONLY : NVS_READWRITE, &_handle)};
+    if (ESP_OK != err) {
+        DBG_PRINT_TAG(TAG, "Error (%s) opening NVS handle %s!", esp_err_to_name(err), storage);
+        return;
+    }
+    _isOpen = true;
+}
+
+NVSSession::~NVSSession() {
+    if (false == _isOpen) {
+        return;
+    }
+    commit();
+    nvs_close(_handle);
+}
+
+bool NVSSession::read(const char* const tag, int64_t& res) const {
+
+    if (false == _isOpen) {
+        return false;
+    }
+
+    int64_t readRes {0};
+    if (false == checked(nvs_get_i64(_handle, tag, &readRes), tag)) {
+        return false;
+    }
+    res = readRes;
+    return true;
+}
+
+bool NVSSession::read(const char* const tag, std::string& res) const {
+
+    if (false == _isOpen) {
+        return false;
+    }
+
+    size_t length {0};
+    if (false == checked(nvs_get_str(_handle, tag, NULL, &length), tag) or 0 == length) {
+        return false;
+    }
+    // read in place, output allocates only when its capacity is too small
+    res.resize(length - 1);
+    if (false == checked(nvs_get_str(_handle, tag, res.data(), &length), tag)) {
+        res.clear();
+        return false;
+    }
+    return true;
+}
+
+bool NVSSession::read(const char* const tag, std::span<char> buffer, size_t& length) const {
+
+    if (false == _isOpen) {
+        return false;
+    }
+
+    size_t readLength {buffer.size()};
+    if (false == checked(nvs_get_str(_handle, tag, buffer.data(), &readLength), tag)) {
+        return false;
+    }
+    length = readLength ? readLength - 1 : 0;
+    return true;
+}
+
+bool NVSSession::readBlob(const char* const tag, std::span<uint8_t> buffer, size_t& length) const {
+
+    if (false == _isOpen) {
+        return false;
+    }
+
+    size_t readLength {0};
+    if (false == checked(nvs_get_blob(_handle, tag, NULL, &readLength), tag)) {
+        return false;
+    }
+    length = readLength;
+    if (readLength > buffer.size()) {
+        return false;
+    }
+    return checked(nvs_get_blob(_handle, tag, buffer.data(), &length), tag);
+}
+
+bool NVSSession::write(const char* const tag, const int64_t val) {
+    return isWritable() and changed(nvs_set_i64(_handle, tag, val), tag, "set");
+}
+
+bool NVSSession::write(const char* const tag, const char* val) {
+    return isWritable() and changed(nvs_set_str(_handle, tag, val), tag, "set");
+}
+
+bool NVSSession::writeBlob(const char* const tag, std::span<const uint8_t> data) {
+    return isWritable() and changed(nvs_set_blob(_handle, tag, data.data(), data.size()), tag, "set");
+}
+
+// span of bytes is trivially copyable too, object template would store the span itself instead of its bytes
+template<typename T>
+concept storedAsObjectBlob = requires (NVSSession& session, const T& value) { session.writeBlob<T>("", value); };
+static_assert(storedAsObjectBlob<double>, "plain object is stored as blob");
+static_assert(false == storedAsObjectBlob<std::span<uint8_t>>, "byte span must reach span overload of writeBlob");
+static_assert(false == storedAsObjectBlob<const uint8_t*>, "pointer must not be stored as blob");
+
+bool NVSSession::erase(const char* const tag) {
+    if (false == isWritable()) {
+        return false;
+    }
+    const esp_err_t err {nvs_erase_key(_handle, tag)};
+    if (ESP_ERR_NVS_NOT_FOUND == err) {
+        return true;
+    }
+    return changed(err, tag, "erase");
+}
+
+bool NVSSession::eraseAll() {
+    return isWritable() and changed(nvs_erase_all(_handle), "*", "erase");
+}
+
+bool NVSSession::checked(const esp_err_t err, const char* const tag) const {
+    if (ESP_OK != err) {
+        if (ESP_ERR_NVS_NOT_FOUND != err) {
+            DBG_PRINT_TAG(TAG, "Error (%s) reading %s!", esp_err_to_name(err), tag);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool NVSSession::changed(const esp_err_t err, const char* const tag, const char* const operation) {
+    if (ESP_OK != err) {
+        DBG_PRINT_TAG(TAG, "failed to %s %s (%s)", operation, tag, esp_err_to_name(err));
+        _failed = true;
+        return false;
+    }
+    ++_pendingChanges;
+    return true;
+}
+
+bool NVSSession::commit() {
+
+    if (false == isWritable()) {
+        return false;
+    }
+
+    const bool failed {_failed};
+    _failed = false;
+    if (0 == _pendingChanges) {
+        return false == failed;
+    }
+
+    _pendingChanges = 0;
+    if (ESP_OK != nvs_commit(_handle)) {
+        DBG_PRINT_TAG(TAG, "failed to commit");
+        return false;
+    }
+    return false == failed;
+}
\ No newline at end of file
@@ -0,0 +1,330 @@
+#include "RecordLog.hpp"
+#include "mutex_locker.hpp"
+#include "ThreadSafeDbg.hpp"
+#include "esp_rom_crc.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const TAG {"RecordLog"};
+static const char* const segmentExtension {".seg"};
+static const char* const cursorFileName {"cursor"};
+static const uint16_t recordMagic {0x5243};
+
+struct recordHeader_t {
+    uint16_t magic;
+    uint16_t length;
+    uint32_t crc32;
+};
+
+enum class eRecordStatus {
+    RECORD_OK,
+    RECORD_END,
+    RECORD_INVALID
+};
+
+static uint32_t recordCrc(const uint16_t length, std::string_view payload) {
+    const uint32_t crc {esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&length), sizeof(length))};
+    return esp_rom_crc32_le(crc, reinterpret_cast<const uint8_t*>(payload.data()), payload.size());
+}
+
+static eRecordStatus readRecord(IFileReader& reader, std::string& payload, const size_t maxLength) {
+
+    recordHeader_t header {};
+    const size_t headerRead {reader.read({reinterpret_cast<char*>(&header), sizeof(header)})};
+
+    if (0 == headerRead) {
+        return eRecordStatus::RECORD_END;
+    }
+    if (sizeof(header) != headerRead or recordMagic != header.magic or header.length > maxLength) {
+        return eRecordStatus::RECORD_INVALID;
+    }
+
+    payload.assign(header.length, '\0');
+    if (header.length != reader.read(payload) or header.crc32 != recordCrc(header.length, payload)) {
+        return eRecordStatus::RECORD_INVALID;
+    }
+    return eRecordStatus::RECORD_OK;
+}
+
+RecordLog::RecordLog(IFileSystemDriver* driver, const std::string& directory, const size_t segmentSize, const float maxUsagePercent)
+    :   _driver{driver},
+        _directory{directory},
+        _segmentSize{segmentSize},
+        _maxUsagePercent{maxUsagePercent} {
+    assert(NULL != driver);
+    assert(segmentSize > sizeof(recordHeader_t));
+    recover();
+}
+
+RecordLog::~RecordLog() {
+    _tail.reset();
+    _reader.reset();
+    delete _driver;
+}
+
+std::string RecordLog::segmentName(const uint32_t segment) const {
+    char name[16] {};
+    snprintf(name, sizeof(name), "%08lx", static_cast<unsigned long>(segment));
+    return _directory + "/" + name + segmentExtension;
+}
+
+std::string RecordLog::cursorName() const {
+    return _directory + "/" + cursorFileName;
+}
+
+void RecordLog::recover() {
+
+    if (auto dir {_driver->openDirectory(_directory)}) {
+        while (const char* const name = dir->next()) {
+            char* end {nullptr};
+            const unsigned long segment {strtoul(name, &end, 16)};
+            if (end != name and 0 == strcmp(end, segmentExtension)) {
+                _segments.push_back(segment);
+            }
+        }
+    }
+    std::sort(_segments.begin(), _segments.end());
+
+    if (_segments.empty()) {
+        return;
+    }
+    _nextSegment = _segments.back() + 1;
+    _committed = position_t{_segments.front(), 0};
+
+    std::string cursor {};
+    unsigned long segment {};
+    size_t offset {};
+    if (true == _driver->readEntireFileToString(cursorName(), cursor)
+        and 2 == sscanf(cursor.c_str(), "%lx:%zu", &segment, &offset)
+        and _segments.end() != std::find(_segments.begin(), _segments.end(), segment)) {
+        _committed = position_t{static_cast<uint32_t>(segment), offset};
+    }
+    _read = _committed;
+
+    // consumed segments which were not deleted before reboot
+    while (_segments.front() != _committed.segment) {
+        dropFrontSegment();
+    }
+
+    validateTail();
+}
+
+void RecordLog::validateTail() {
+
+    _tailSize = 0;
+    _tailSealed = false;
+
+    auto reader {_driver->openForReading(segmentName(_segments.back()))};
+    if (!reader) {
+        _tailSealed = true;
+        return;
+    }
+
+    std::string payload {};
+    eRecordStatus status {};
+    while (eRecordStatus::RECORD_OK == (status = readRecord(*reader, payload, _segmentSize))) {
+        _tailSize += sizeof(recordHeader_t) + payload.size();
+    }
+
+    // torn write after power loss, appends continue in a fresh segment
+    if (eRecordStatus::RECORD_INVALID == status) {
+        DBG_PRINT_TAG(TAG, "torn tail in %s at %zu", segmentName(_segments.back()).c_str(), _tailSize);
+        _tailSealed = true;
+    }
+}
+
+bool RecordLog::nextSegment(const uint32_t segment, uint32_t& next) const {
+    const auto found {std::upper_bound(_segments.begin(), _segments.end(), segment)};
+    if (_segments.end() == found) {
+        return false;
+    }
+    next = *found;
+    return true;
+}
+
+void RecordLog::dropFrontSegment() {
+
+    const uint32_t dropped {_segments.front()};
+    if (_segments.size() == 1) {
+        _tail.reset();
+        _tailSize = 0;
+        _tailSealed = false;
+    }
+    _driver->deleteFile(segmentName(dropped));
+    _segments.pop_front();
+
+    const position_t next {_segments.empty() ? _nextSegment : _segments.front(), 0};
+    if (_read.segment == dropped) {
+        _reader.reset();
+        _read = next;
+    }
+    if (_committed.segment == dropped) {
+        _committed = next;
+    }
+}
+
+void RecordLog::enforceUsageLimit() {
+    while (false == _segments.empty() and _driver->usagePercent() > _maxUsagePercent) {
+        DBG_PRINT_TAG(TAG, "usage limit reached, dropping segment %lu", static_cast<unsigned long>(_segments.front()));
+        dropFrontSegment();
+        ++_stats.droppedSegments;
+    }
+}
+
+bool RecordLog::startSegment() {
+
+    _tail.reset();
+    enforceUsageLimit();
+
+    if (_segments.empty()) {
+        _read = _committed = position_t{_nextSegment, 0};
+    }
+    _segments.push_back(_nextSegment++);
+    _tailSize = 0;
+    _tailSealed = false;
+    return true;
+}
+
+bool RecordLog::append(std::string_view record) {
+
+    MutexLocker locker{_mutex};
+    const size_t recordSize {sizeof(recordHeader_t) + record.size()};
+
+    if (recordSize > _segmentSize or record.size() > UINT16_MAX) {
+        DBG_PRINT_TAG(TAG, "record too big: %zu", record.size());
+        return false;
+    }
+
+    if (_segments.empty() or _tailSealed or _tailSize + recordSize > _segmentSize) {
+        startSegment();
+    }
+
+    if (!_tail) {
+        _tail = _driver->openForWriting(segmentName(_segments.back()), eWriteMode::WRITE_APPEND);
+    }
+
+    const uint16_t length {static_cast<uint16_t>(record.size())};
+    const recordHeader_t header {recordMagic, length, recordCrc(length, record)};
+
+    if (!_tail
+        or sizeof(header) != _tail->write({reinterpret_cast<const char*>(&header), sizeof(header)})
+        or record.size() != _tail->write(record)
+        or false == _tail->sync()) {
+        DBG_PRINT_TAG(TAG, "failed to append to %s", segmentName(_segments.back()).c_str());
+        // partial record would end the segment anyway
+        _tail.reset();
+        _tailSealed = true;
+        return false;
+    }
+
+    _tailSize += recordSize;
+    ++_stats.appended;
+    return true;
+}
+
+bool RecordLog::openSegmentForReading(const position_t& position) {
+
+    _reader = _driver->openForReading(segmentName(position.segment));
+    if (!_reader) {
+        return false;
+    }
+
+    char skipBuffer[64];
+    for (size_t skipped = 0; skipped < position.offset;) {
+        const size_t toSkip {std::min(sizeof(skipBuffer), position.offset - skipped)};
+        if (toSkip != _reader->read({skipBuffer, toSkip})) {
+            _reader.reset();
+            return false;
+        }
+        skipped += toSkip;
+    }
+    return true;
+}
+
+bool RecordLog::readNext(std::string& record) {
+
+    MutexLocker locker{_mutex};
+
+    while (false == _segments.empty()) {
+        const bool isTail {_read.segment == _segments.back()};
+
+        if (isTail and _read.offset >= _tailSize) {
+            // handle is reopened later to see records appended meanwhile
+            _reader.reset();
+            return false;
+        }
+
+        eRecordStatus status {eRecordStatus::RECORD_INVALID};
+        if (_reader or true == openSegmentForReading(_read)) {
+            status = readRecord(*_reader, record, _segmentSize);
+        }
+
+        if (eRecordStatus::RECORD_OK == status) {
+            _read.offset += sizeof(recordHeader_t) + record.size();
+            ++_uncommittedRecords;
+            return true;
+        }
+
+        if (eRecordStatus::RECORD_INVALID == status) {
+            DBG_PRINT_TAG(TAG, "skipping rest of %s", segmentName(_read.segment).c_str());
+            ++_stats.corruptedSegments;
+        }
+
+        _reader.reset();
+        uint32_t next {};
+        if (isTail or false == nextSegment(_read.segment, next)) {
+            _tailSealed = _tailSealed or isTail;
+            return false;
+        }
+        _read = position_t{next, 0};
+    }
+    return false;
+}
+
+bool RecordLog::commit() {
+
+    MutexLocker locker{_mutex};
+
+    if (_read.segment == _committed.segment and _read.offset == _committed.offset) {
+        return true;
+    }
+
+    while (false == _segments.empty() and _segments.front() < _read.segment) {
+        dropFrontSegment();
+    }
+
+    _committed = _read;
+    _stats.consumed += _uncommittedRecords;
+    _uncommittedRecords = 0;
+    return persistCursor();
+}
+
+void RecordLog::rewind() {
+    MutexLocker locker{_mutex};
+    _reader.reset();
+    _read = _committed;
+    _uncommittedRecords = 0;
+}
+
+bool RecordLog::persistCursor() const {
+    char cursor[32] {};
+    snprintf(cursor, sizeof(cursor), "%08lx:%zu", static_cast<unsigned long>(_committed.segment), _committed.offset);
+    return _driver->writeContentToFile(cursor, cursorName());
+}
+
+bool RecordLog::isEmpty() const {
+    MutexLocker locker{_mutex};
+    return _segments.empty() or (_read.segment == _segments.back() and _read.offset >= _tailSize);
+}
+
+size_t RecordLog::segmentsCount() const {
+    MutexLocker locker{_mutex};
+    return _segments.size();
+}
+
+recordLogStats_t RecordLog::stats() const {
+    MutexLocker locker{_mutex};
+    return _stats;
+}
\ No newline at end of file
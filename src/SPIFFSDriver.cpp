@@ -1,8 +1,8 @@
 #include "sdkconfig.h"
 #if CONFIG_ENABLE_ARDUINO_SPIFFS_DRIVER
 #include "SPIFFSDriver.hpp"
+#include "StdioFileStream.hpp"
 #include <SPIFFS.h>
-#include <Stream.h>
 #include "md5.hpp"
 #include "FilePathUtils.hpp"
 #include "ThreadSafeDbg.hpp"
@@ -12,6 +12,55 @@ static const char* const TAG {"SPIFFS_DRIVER"};
 
 static const uint32_t maxFileNameLength {31};
 
+struct ArduinoFileReader : IFileReader {
+    explicit ArduinoFileReader(File&& file) : _file{std::move(file)} {}
+    ~ArduinoFileReader() { _file.close(); }
+    size_t read(std::span<char> buffer) override {
+        return _file.read(reinterpret_cast<uint8_t*>(buffer.data()), buffer.size());
+    }
+    size_t size() const override { return _file.size(); }
+private:
+    File _file;
+};
+
+struct ArduinoFileWriter : IFileWriter {
+    explicit ArduinoFileWriter(File&& file) : _file{std::move(file)} {}
+    ~ArduinoFileWriter() { close(); }
+    size_t write(std::span<const char> data) override {
+        return _file.write(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+    bool sync() override {
+        _file.flush();
+        return true;
+    }
+    bool close() override {
+        if (false == _file) {
+            return false;
+        }
+        _file.flush();
+        _file.close();
+        return true;
+    }
+private:
+    File _file;
+};
+
+struct ArduinoDirectoryReader : IDirectoryReader {
+    explicit ArduinoDirectoryReader(File&& root) : _root{std::move(root)} {}
+    ~ArduinoDirectoryReader() {
+        _file.close();
+        _root.close();
+    }
+    const char* next() override {
+        _file.close();
+        _file = _root.openNextFile();
+        return (true == _file) ? _file.name() : nullptr;
+    }
+private:
+    File _root;
+    File _file;
+};
+
 SPIFFSDriver::SPIFFSDriver() {
     initialize();
 }
@@ -32,159 +81,98 @@ void SPIFFSDriver::initialize() {
     }
 }
 
-bool SPIFFSDriver::writeContentToFile (const std::string& content, const std::string& filename) const {
-    if (filename.length() > maxFileNameLength) {
-        ESP_LOGE(TAG, "max filename length exceeded: %s!", filename.c_str());
-        return false;
-    }
-    return doWriteContentToFile(content, filename, false);
-}
+bool SPIFFSDriver::deleteFile(std::string_view filename) const {
 
-bool SPIFFSDriver::appendContentToFile (const string& content, const string& filename) const {
     if (filename.length() > maxFileNameLength) {
-        ESP_LOGE(TAG, "max filename length exceeded: %s!", filename.c_str());
+        ESP_LOGE(TAG, "max filename length exceeded: " PATH_FMT "!", PATH_ARG(filename));
         return false;
     }
-    return doWriteContentToFile(content, filename, true);
-}
-
-uint32_t SPIFFSDriver::countFiles (const string& path) const {
-    uint32_t ret {0};
-
-    File root = SPIFFS.open(path.c_str());
-
-    if (false == root) {
-        ESP_LOGE(TAG, "Failed to open path");
-        root.close();
-        return 0;
-    }
 
-    File file = root.openNextFile();
-
-    while (true == file) {
-        ++ret;
-        file.close();
-        file = root.openNextFile();
+    if (false == doesFileExist(filename)) {
+        return true;
     }
-
-    root.close();
-    file.close();
-    return ret;
-}
-
-vector<std::string> SPIFFSDriver::filesList(const std::string& path) const {
-    
-    std::vector<std::string> ret;
-
-    File root = SPIFFS.open(path.c_str());
-    if (false == root) {
-        ESP_LOGE(TAG, "Failed to open path: %s", path.c_str());
-        root.close();
-        return ret;
+    if (true == SPIFFS.remove(FilePath{filename}.c_str())) {
+        return true;
     }
-
-    File file = root.openNextFile();
-
-    while (true == file) {
-        ret.push_back(file.name());
-        file.close();
-        file = root.openNextFile();
+    else {
+        return false;
     }
-
-    root.close();
-    file.close();
-
-    return ret;
+    return false;
 }
 
-bool SPIFFSDriver::readEntireFileToString (const std::string& filename, std::string& output) const {
-    
-    if (filename.length() > maxFileNameLength) {
-        ESP_LOGE(TAG, "max filename length exceeded: %s!", filename.c_str());
-        return false;
-    }
+bool SPIFFSDriver::renameFile(std::string_view from, std::string_view to) const {
 
-    if (false == doesFileExist(filename)) {
+    if (from.length() > maxFileNameLength or to.length() > maxFileNameLength) {
+        ESP_LOGE(TAG, "max filename length exceeded: " PATH_FMT "!", PATH_ARG(to));
         return false;
     }
-    
-    File file = SPIFFS.open(filename.c_str(), FILE_READ);
 
-    if (false == file) {
+    const FilePath toPath {to};
+    if (true == SPIFFS.exists(toPath.c_str()) and false == SPIFFS.remove(toPath.c_str())) {
         return false;
     }
+    return SPIFFS.rename(FilePath{from}.c_str(), toPath.c_str());
+}
 
-    const size_t fileSize = file.size();
-    
-    vector<char> tempBuffer;
-    tempBuffer.resize(fileSize, '\0');
-
-    const size_t bytesRead = file.readBytes((char*)tempBuffer.data(), fileSize);
-
-    file.close();
+bool SPIFFSDriver::doesFileExist(std::string_view filename) const {
 
-    if (fileSize == bytesRead) {
-        output = string(tempBuffer.begin(), tempBuffer.end());
-        return true;
-    }
-    else {
+    if (filename.length() > maxFileNameLength) {
+        ESP_LOGE(TAG, "max filename length exceeded: " PATH_FMT "!", PATH_ARG(filename));
         return false;
     }
+    return SPIFFS.exists(FilePath{filename}.c_str());
 }
 
-bool SPIFFSDriver::deleteFile(const std::string& filename) const {
+fileReader_t SPIFFSDriver::doOpenForReading(std::string_view filename) const {
 
     if (filename.length() > maxFileNameLength) {
-        ESP_LOGE(TAG, "max filename length exceeded: %s!", filename.c_str());
-        return false;
+        ESP_LOGE(TAG, "max filename length exceeded: " PATH_FMT "!", PATH_ARG(filename));
+        return nullptr;
     }
 
     if (false == doesFileExist(filename)) {
-        return true;
-    }
-    if (true == SPIFFS.remove(filename.c_str())) {
-        return true;
+        return nullptr;
     }
-    else {
-        return false;
+
+    const FilePath path {filename};
+    File file = SPIFFS.open(path.c_str(), FILE_READ);
+
+    if (false == file) {
+        ESP_LOGE(TAG, "failed to open file: %s", path.c_str());
+        return nullptr;
     }
-    return false;
+
+    return std::make_unique<ArduinoFileReader>(std::move(file));
 }
 
-bool SPIFFSDriver::doesFileExist(const std::string& filename) const {
+fileWriter_t SPIFFSDriver::doOpenForWriting(std::string_view filename, const eWriteMode mode) const {
 
     if (filename.length() > maxFileNameLength) {
-        ESP_LOGE(TAG, "max filename length exceeded: %s!", filename.c_str());
-        return false;
+        ESP_LOGE(TAG, "max filename length exceeded: " PATH_FMT "!", PATH_ARG(filename));
+        return nullptr;
     }
-    return SPIFFS.exists(filename.c_str());
-}
-
-bool SPIFFSDriver::doWriteContentToFile(const std::string& content, const std::string& filename, const bool append) const {
 
-    bool result = false;
-    const char* modeKey = append? FILE_APPEND : FILE_WRITE;
-    File file = SPIFFS.open(filename.c_str(), modeKey);
+    const FilePath path {filename};
+    File file = SPIFFS.open(path.c_str(), openModeString(mode));
 
-    if (true == file){
-        result = printContentToStream(content, file);
-    }
-    else {
-        ESP_LOGE(TAG, "failed to open file: %s", filename.c_str());
+    if (false == file) {
+        ESP_LOGE(TAG, "failed to open file: %s", path.c_str());
+        return nullptr;
     }
 
-    file.close();
-    return result;
+    return std::make_unique<ArduinoFileWriter>(std::move(file));
 }
 
+directoryReader_t SPIFFSDriver::openDirectory(const std::string& path) const {
 
-bool SPIFFSDriver::printContentToStream(const std::string& content, Stream& stream) const {
-    const size_t printedBytes {stream.write(content.data(), content.length())};
-    if(printedBytes != content.length()) {
-        ESP_LOGE(TAG, "error while printing content to Stream!");
-        return false;
+    File root = SPIFFS.open(path.c_str());
+    if (false == root) {
+        ESP_LOGE(TAG, "Failed to open path: %s", path.c_str());
+        root.close();
+        return nullptr;
     }
-    return true; 
+
+    return std::make_unique<ArduinoDirectoryReader>(std::move(root));
 }
 
 bool SPIFFSDriver::format() const {
@@ -203,4 +191,8 @@ float SPIFFSDriver::usagePercent() const {
 
     return usagePercent;
 }
+
+size_t SPIFFSDriver::totalBytes() const {
+    return SPIFFS.totalBytes();
+}
 #endif
\ No newline at end of file
@@ -1,8 +1,13 @@
 #include "sdkconfig.h"
 #include "SPIFFS_IDFDriver.hpp"
+#include "StdioFileStream.hpp"
 #include "md5.hpp"
 #include "FilePathUtils.hpp"
+#include "ESP32Utils.hpp"
+#include "NVS.hpp"
+#include "mutex_locker.hpp"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "unistd.h"
 #include <memory>
 #include <dirent.h>
@@ -12,18 +17,98 @@
 
 static const char* const TAG {"SPIFFS_IDFDriver"};
 
-SPIFFS_IDFDriver::SPIFFS_IDFDriver(const char* const path, const size_t maxFiles)
-    :   _conf{path, NULL, maxFiles, true} {
+// keeps index in sync with what was written through the driver
+struct IndexedFileWriter : IFileWriter {
+    IndexedFileWriter(fileWriter_t&& writer, FileIndex& index, std::string_view filename, const eWriteMode mode)
+        :   _writer{std::move(writer)}, _index{index}, _filename{filename}, _mode{mode} {
+        if (eWriteMode::WRITE_TRUNCATE == _mode) {
+            _index.update(_filename, 0);
+        }
+    }
+    ~IndexedFileWriter() { close(); }
+    size_t write(std::span<const char> data) override {
+        const size_t written {_writer->write(data)};
+        _bytesWritten += written;
+        return written;
+    }
+    bool sync() override { return _writer->sync(); }
+    bool close() override {
+        if (_closed) {
+            return false;
+        }
+        _closed = true;
+        const bool ret {_writer->close()};
+        if (eWriteMode::WRITE_OVERWRITE == _mode) {
+            _index.update(_filename);
+        }
+        else {
+            _index.grow(_filename, _bytesWritten);
+        }
+        return ret;
+    }
+private:
+    fileWriter_t _writer;
+    FileIndex& _index;
+    std::string _filename;
+    eWriteMode _mode;
+    size_t _bytesWritten{};
+    bool _closed{false};
+};
+
+// measures whole write from open to close, that is where gc stalls show up
+struct TimedFileWriter : IFileWriter {
+    TimedFileWriter(fileWriter_t&& writer, const SPIFFS_IDFDriver& driver, const int64_t openedUs)
+        :   _writer{std::move(writer)}, _driver{driver}, _openedUs{openedUs} {}
+    ~TimedFileWriter() { close(); }
+    size_t write(std::span<const char> data) override { return _writer->write(data); }
+    bool sync() override { return _writer->sync(); }
+    bool close() override {
+        if (_closed) {
+            return false;
+        }
+        _closed = true;
+        const bool ret {_writer->close()};
+        _driver.onWriteDone(static_cast<uint32_t>(esp_timer_get_time() - _openedUs));
+        return ret;
+    }
+private:
+    fileWriter_t _writer;
+    const SPIFFS_IDFDriver& _driver;
+    int64_t _openedUs;
+    bool _closed{false};
+};
+
+SPIFFS_IDFDriver::SPIFFS_IDFDriver(const char* const path, const size_t maxFiles, const bool useIndex, const eSpiffsCheckMode checkMode)
+    :   _conf{path, NULL, maxFiles, true},
+        _index{useIndex ? std::make_unique<FileIndex>() : nullptr},
+        _checkMode{checkMode} {
     initialize();
 }
 
 SPIFFS_IDFDriver::~SPIFFS_IDFDriver() {
+    stopMaintenance();
+    waitForCheck();
+    _checkTask.reset();
+    if (_rebootHookId) {
+        ESP32Utils::removeRebootHook(_rebootHookId);
+        if (_isReady and eSpiffsCheckState::CHECK_FAILED != _checkState) {
+            setShutdownClean(true);
+        }
+    }
     esp_vfs_spiffs_unregister(_conf.partition_label);
 }
 
 
 void SPIFFS_IDFDriver::initialize() {
+    waitForCheck();
+    _checkTask.reset();
     _isReady = false;
+    _checkState = eSpiffsCheckState::CHECK_NOT_STARTED;
+    {
+        MutexLocker locker{_statsMutex};
+        _mountStats = spiffsMountStats_t{};
+    }
+    const int64_t start {esp_timer_get_time()};
     esp_err_t err = esp_vfs_spiffs_register(&_conf);
 
     if (err != ESP_OK) {
@@ -36,164 +121,278 @@ void SPIFFS_IDFDriver::initialize() {
         }
         return;
     }
-    err = esp_spiffs_check(_conf.partition_label);
 
-    if(ESP_OK != err) {
-        ESP_LOGE(TAG, "spiffs check procedure failed!");
+    const bool background {eSpiffsCheckMode::CHECK_IN_BACKGROUND == _checkMode
+        or eSpiffsCheckMode::CHECK_IN_BACKGROUND_AFTER_UNCLEAN_SHUTDOWN == _checkMode};
+    const bool usesMarker {eSpiffsCheckMode::CHECK_AFTER_UNCLEAN_SHUTDOWN == _checkMode
+        or eSpiffsCheckMode::CHECK_IN_BACKGROUND_AFTER_UNCLEAN_SHUTDOWN == _checkMode};
+    bool needsCheck {true};
+
+    if (usesMarker) {
+        needsCheck = false == wasShutdownClean();
+        // marker is dirty for the whole session, cleared again on unmount or restart
+        setShutdownClean(false);
+        if (0 == _rebootHookId) {
+            _rebootHookId = ESP32Utils::addRebootHook([this]() {
+                if (_isReady and eSpiffsCheckState::CHECK_FAILED != _checkState) {
+                    setShutdownClean(true);
+                }
+            });
+        }
+    }
+
+    if (false == needsCheck) {
+        _checkState = eSpiffsCheckState::CHECK_SKIPPED;
+    }
+    else if (background) {
+        _checkState = eSpiffsCheckState::CHECK_RUNNING;
+    }
+    else if (false == runCheck()) {
         return;
     }
+
+    buildIndex();
     _isReady = true;
-}
+    const bool checkDeferred {eSpiffsCheckState::CHECK_RUNNING == _checkState};
+    {
+        MutexLocker locker{_statsMutex};
+        _mountStats.mountUs = static_cast<uint32_t>(esp_timer_get_time() - start);
+        _mountStats.checkDeferred = checkDeferred;
+    }
 
-bool SPIFFS_IDFDriver::format() const {
-    return ESP_OK == esp_spiffs_format(_conf.partition_label);
+    if (checkDeferred) {
+        // spiffs api is serialized internally, file operations just wait while check holds the lock
+        _checkTask = std::make_unique<AsyncFunctor>([this]() {
+            if (runCheck()) {
+                // check may drop objects of interrupted writes
+                buildIndex();
+            }
+        }, "spiffs_check", SPIFFS_CHECK_DEFAULT_STACK_SIZE);
+        _checkTask->start();
+    }
 }
 
-bool SPIFFS_IDFDriver::writeContentToFile (const std::string& content, const std::string& filename) const {
+bool SPIFFS_IDFDriver::runCheck() {
 
-    FILE* file = fopen(filename.c_str(), "w");
-    if (!file) {
-        ESP_LOGE(TAG, "Failed to open file for writing");
+    _checkState = eSpiffsCheckState::CHECK_RUNNING;
+    const int64_t start {esp_timer_get_time()};
+    const esp_err_t err {esp_spiffs_check(_conf.partition_label)};
+    {
+        MutexLocker locker{_statsMutex};
+        _mountStats.checkUs = static_cast<uint32_t>(esp_timer_get_time() - start);
+    }
+
+    if(ESP_OK != err) {
+        ESP_LOGE(TAG, "spiffs check procedure failed!");
+        _checkState = eSpiffsCheckState::CHECK_FAILED;
         return false;
     }
+    _checkState = eSpiffsCheckState::CHECK_PASSED;
+    return true;
+}
 
-    return doWriteContentToFile(content, file);
+void SPIFFS_IDFDriver::waitForCheck() const {
+    while (_checkTask and eSpiffsCheckState::CHECK_RUNNING == _checkState) {
+        Task::delay(10);
+    }
 }
 
-bool SPIFFS_IDFDriver::appendContentToFile (const std::string& content, const std::string& filename) const {
+spiffsMountStats_t SPIFFS_IDFDriver::mountStats() const {
+    MutexLocker locker{_statsMutex};
+    return _mountStats;
+}
 
-    FILE* file = fopen(filename.c_str(), "a");
-    if (!file) {
-        ESP_LOGE(TAG, "Failed to open file for writing");
-        return false;
-    }
+bool SPIFFS_IDFDriver::isChecked() const {
+    return eSpiffsCheckState::CHECK_PASSED == _checkState or eSpiffsCheckState::CHECK_SKIPPED == _checkState;
+}
 
-    return doWriteContentToFile(content, file);
+// one marker per partition, nvs keys are limited to 15 characters
+static std::string markerKey(const char* const partitionLabel) {
+    return std::string(partitionLabel ? partitionLabel : "default").substr(0, 15);
 }
 
-bool SPIFFS_IDFDriver::doWriteContentToFile(const std::string& content, FILE* file) const {
-    const auto blocksWritten = fprintf(file, content.c_str());
-    if (!blocksWritten) {
-        fclose(file);
-        ESP_LOGE(TAG, "fwrite operation failed");
+bool SPIFFS_IDFDriver::wasShutdownClean() const {
+    NVS nvs {};
+    int64_t clean {0};
+    // missing marker means first boot with this mode, check once to be sure
+    if (false == nvs.read(SPIFFS_CHECK_MARKER_STORAGE, markerKey(_conf.partition_label).c_str(), clean)) {
         return false;
     }
-
-    fclose(file);
-
-    return true;
+    _shutdownClean = 1 == clean;
+    return _shutdownClean.value();
 }
 
+void SPIFFS_IDFDriver::setShutdownClean(const bool clean) const {
+    if (_shutdownClean == clean) {
+        return;
+    }
+    NVS nvs {};
+    if (false == nvs.write(SPIFFS_CHECK_MARKER_STORAGE, markerKey(_conf.partition_label).c_str(), clean ? 1 : 0)) {
+        ESP_LOGE(TAG, "failed to store shutdown marker");
+        return;
+    }
+    _shutdownClean = clean;
+}
 
-uint32_t SPIFFS_IDFDriver::countFiles (const std::string& path) const {
+void SPIFFS_IDFDriver::buildIndex() {
 
-    DIR *dir_ptr = NULL;
-    struct dirent *direntp;
-    char *npath;
-    if (!path.c_str()) return 0;
-    if( (dir_ptr = opendir(path.c_str())) == NULL ) return 0;
+    if (!_index) {
+        return;
+    }
 
-    int count=0;
-    while( (direntp = readdir(dir_ptr)))
-    {
-        if (strcmp(direntp->d_name,".")==0 ||
-            strcmp(direntp->d_name,"..")==0) continue;
-        switch (direntp->d_type) {
-            case DT_REG:
-                ++count;
-                break;
-        }
+    DIR* dir = opendir(_conf.base_path);
+    if (!dir) {
+        return;
     }
-    closedir(dir_ptr);
-    return count;
 
-    // uint32_t ret {0};
+    // other tasks keep using the current index while the directory is scanned
+    const uint32_t scanStart {_index->currentGeneration()};
+    FileIndex scanned {};
 
-    // struct dirent* entry;
+    // sizes are resolved lazily, stat on every file would scan object table n times
+    DirentDirectoryReader reader{dir};
+    const std::string basePath {std::string(_conf.base_path).append("/")};
+    while (const char* const name = reader.next()) {
+        scanned.update(basePath + name);
+    }
+    _index->replaceWith(std::move(scanned), scanStart);
+}
 
-    // DIR* dirp = opendir(path.c_str());
+bool SPIFFS_IDFDriver::format() const {
+    const bool ret {ESP_OK == esp_spiffs_format(_conf.partition_label)};
+    if (_index) {
+        _index->clear();
+    }
+    return ret;
+}
 
-    // if(!dirp) {
-    //     return 0;
-    // }
+fileReader_t SPIFFS_IDFDriver::doOpenForReading(std::string_view filename) const {
 
-    // while ((entry = readdir(dirp)) != NULL) {
-    //     if (entry->d_type == DT_REG) { /* If the entry is a regular file */
-    //         ret++;
-    //     }
-    // }
-    // closedir(dirp);
+    const FilePath path {filename};
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file) {
+        ESP_LOGD(TAG, "Failed to open file for reading: %s", path.c_str());
+        return nullptr;
+    }
 
-    // return ret;
-    // return n;
+    return std::make_unique<StdioFileReader>(file);
 }
 
-std::vector<std::string> SPIFFS_IDFDriver::filesList(const std::string& path) const {
-    
-    std::vector<std::string> ret;
+fileWriter_t SPIFFS_IDFDriver::doOpenForWriting(std::string_view filename, const eWriteMode mode) const {
 
-    DIR * dirp;
-    struct dirent* entry;
+    const int64_t openedUs {esp_timer_get_time()};
+    _lastWriteMs = ESP32Utils::millis();
+    const FilePath path {filename};
+    FILE* file = fopen(path.c_str(), openModeString(mode));
+    if (!file) {
+        ESP_LOGE(TAG, "Failed to open file for writing: %s", path.c_str());
+        return nullptr;
+    }
 
-    dirp = opendir(path.c_str());
+    fileWriter_t writer {std::make_unique<StdioFileWriter>(file)};
 
-    if(!dirp) {
-        return ret;
+    if (_index) {
+        writer = std::make_unique<IndexedFileWriter>(std::move(writer), *_index, filename, mode);
+    }
+    // close time matters only to gc quiet period and latency histogram
+    if (_maintenanceRequested or _trackWriteLatency) {
+        writer = std::make_unique<TimedFileWriter>(std::move(writer), *this, openedUs);
     }
+    return writer;
+}
 
-    while ((entry = readdir(dirp)) != NULL) {
-        if (entry->d_type == DT_REG) {
-            ret.emplace_back(entry->d_name);
-        }
+
+directoryReader_t SPIFFS_IDFDriver::openDirectory(const std::string& path) const {
+
+    if (_index) {
+        return _index->openDirectory(path);
     }
-    closedir(dirp);
 
-    return ret;
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return nullptr;
+    }
+
+    return std::make_unique<DirentDirectoryReader>(dir);
 }
 
-bool SPIFFS_IDFDriver::readEntireFileToString (const std::string& filename, std::string& output) const {
-    
+uint32_t SPIFFS_IDFDriver::countFiles (const std::string& path) const {
+
+    if (_index) {
+        return _index->count(path);
+    }
+    return AbstractFileSystemDriver::countFiles(path);
+}
+
+bool SPIFFS_IDFDriver::deleteFile(std::string_view filename) const {
     if (false == doesFileExist(filename)) {
-        return false;
+        return true;
     }
+    return unlinkFile(filename);
+}
 
-    FILE* file = fopen(filename.c_str(), "r");
-    if (!file) {
-        ESP_LOGE(TAG, "Failed to open file for reading");
+bool SPIFFS_IDFDriver::unlinkFile(std::string_view filename) const {
+    if (0 != unlink(FilePath{filename}.c_str())) {
         return false;
     }
+    if (_index) {
+        _index->remove(filename);
+    }
+    return true;
+}
 
-    fseek(file, 0, SEEK_END);
-    const auto fileSize = ftell(file);
-    rewind(file);
+bool SPIFFS_IDFDriver::deleteMany(const std::vector<std::string>& filenames) const {
 
-    auto pBuffer {std::make_shared<char[]>(fileSize + 1)};
-    const auto blocksRead {fread(pBuffer.get(), fileSize, 1, file)};
-    if (!blocksRead) {
-        fclose(file);
-        ESP_LOGE(TAG, "fread operation failed");
-        return false;
+    // unlink of missing object scans whole object table, so missing files are filtered by one scan first
+    bool ret {true};
+    const std::vector<bool> exists {existsMany(filenames)};
+
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        if (exists[i]) {
+            ret = unlinkFile(filenames[i]) and ret;
+        }
     }
+    return ret;
+}
 
-    pBuffer.get()[fileSize] = '\0';
+std::vector<bool> SPIFFS_IDFDriver::existsMany(const std::vector<std::string>& filenames) const {
 
-    fclose(file);
+    if (!_index) {
+        return AbstractFileSystemDriver::existsMany(filenames);
+    }
 
-    std::string{pBuffer.get()}.swap(output);
+    std::vector<bool> ret {};
+    ret.reserve(filenames.size());
+    for (const auto& filename : filenames) {
+        ret.push_back(_index->contains(filename));
+    }
+    return ret;
+}
 
+bool SPIFFS_IDFDriver::renameFile(std::string_view from, std::string_view to) const {
+    const FilePath fromPath {from};
+    const FilePath toPath {to};
+    if (0 != rename(fromPath.c_str(), toPath.c_str())) {
+        // SPIFFS refuses to rename onto an existing object, replace is not atomic:
+        // power loss after unlink leaves only from, callers have to recover from it
+        if (false == doesFileExist(from) or 0 != unlink(toPath.c_str()) or 0 != rename(fromPath.c_str(), toPath.c_str())) {
+            return false;
+        }
+    }
+    if (_index) {
+        _index->rename(from, to);
+    }
     return true;
 }
 
-bool SPIFFS_IDFDriver::deleteFile(const std::string& filename) const {
-    if (false == doesFileExist(filename)) {
-        return true;
+bool SPIFFS_IDFDriver::doesFileExist(std::string_view filename) const {
+
+    if (_index) {
+        return _index->contains(filename);
     }
-    return 0 == unlink(filename.c_str());
-}
 
-bool SPIFFS_IDFDriver::doesFileExist(const std::string& filename) const {
     struct stat st;
-    if(0 == stat(filename.c_str(), &st)) {
+    if(0 == stat(FilePath{filename}.c_str(), &st)) {
         if (S_ISREG(st.st_mode)) {
             return true;
         }
@@ -201,6 +400,47 @@ bool SPIFFS_IDFDriver::doesFileExist(const std::string& filename) const {
     return false;
 }
 
+bool SPIFFS_IDFDriver::getFileSize(std::string_view filename, size_t& size) const {
+
+    if (_index) {
+        if (false == _index->contains(filename)) {
+            return false;
+        }
+        if (true == _index->size(filename, size)) {
+            return true;
+        }
+    }
+
+    struct stat st;
+    if(0 == stat(FilePath{filename}.c_str(), &st) and S_ISREG(st.st_mode)) {
+        size = st.st_size;
+        if (_index) {
+            _index->resolveSize(filename, size);
+        }
+        return true;
+    }
+    return false;
+}
+
+std::string SPIFFS_IDFDriver::getFileDigest(std::string_view filename, const eDigestType type) const {
+
+    if (!_index) {
+        return AbstractFileSystemDriver::getFileDigest(filename, type);
+    }
+
+    std::string ret {};
+    if (true == _index->digest(filename, type, ret)) {
+        return ret;
+    }
+
+    const uint32_t generation {_index->generation(filename)};
+    ret = AbstractFileSystemDriver::getFileDigest(filename, type);
+    if (false == ret.empty()) {
+        _index->setDigest(filename, type, ret, generation);
+    }
+    return ret;
+}
+
 float SPIFFS_IDFDriver::usagePercent() const  {
 
     size_t totalBytes {};
@@ -212,4 +452,104 @@ float SPIFFS_IDFDriver::usagePercent() const  {
     const float usagePercent {100.0F * static_cast<float>(usedBytes) / totalBytes};
 
     return usagePercent;
+}
+
+size_t SPIFFS_IDFDriver::totalBytes() const {
+
+    size_t totalBytes {};
+    size_t usedBytes {};
+
+    if (ESP_OK != esp_spiffs_info(_conf.partition_label, &totalBytes, &usedBytes))
+        return 0;
+
+    return totalBytes;
+}
+
+bool SPIFFS_IDFDriver::startMaintenance(const spiffsGcConfig_t& config) {
+
+    if (_maintenance) {
+        ESP_LOGE(TAG, "maintenance already started");
+        return false;
+    }
+
+    _gcConfig = config;
+    _maintenanceRequested = true;
+    _maintenanceRunning = true;
+    _maintenance = std::make_unique<AsyncFunctor>([this](){ maintenanceLoop(); }, "spiffs_gc", SPIFFS_GC_DEFAULT_STACK_SIZE);
+    _maintenance->start();
+    return true;
+}
+
+void SPIFFS_IDFDriver::stopMaintenance() {
+
+    if (!_maintenance) {
+        return;
+    }
+
+    // task is not deleted in the middle of gc, it holds spiffs lock
+    _maintenanceRequested = false;
+    while (_maintenanceRunning) {
+        Task::delay(10);
+    }
+    _maintenance.reset();
+}
+
+void SPIFFS_IDFDriver::maintenanceLoop() {
+
+    while (_maintenanceRequested) {
+        Task::delay(_gcConfig.checkPeriodMs);
+
+        if (false == _maintenanceRequested or false == _isReady) {
+            continue;
+        }
+        if (ESP32Utils::millis() - _lastWriteMs < _gcConfig.quietPeriodMs) {
+            continue;
+        }
+        if (usagePercent() < _gcConfig.usageWatermarkPercent) {
+            continue;
+        }
+        collectGarbage();
+    }
+    _maintenanceRunning = false;
+}
+
+void SPIFFS_IDFDriver::collectGarbage() {
+
+    const int64_t start {esp_timer_get_time()};
+    // ESP_ERR_NOT_FINISHED only means there was nothing left to free
+    const esp_err_t err {esp_spiffs_gc(_conf.partition_label, _gcConfig.gcBytes)};
+    const uint32_t duration {static_cast<uint32_t>(esp_timer_get_time() - start)};
+
+    MutexLocker locker{_statsMutex};
+    ++_gcStats.runs;
+    if (ESP_OK != err and ESP_ERR_NOT_FINISHED != err) {
+        ++_gcStats.failures;
+        ESP_LOGE(TAG, "gc failed (%s)", esp_err_to_name(err));
+    }
+    _gcStats.lastDurationUs = duration;
+    _gcStats.totalDurationUs += duration;
+}
+
+void SPIFFS_IDFDriver::onWriteDone(const uint32_t durationUs) const {
+    _lastWriteMs = ESP32Utils::millis();
+    if (false == _trackWriteLatency) {
+        return;
+    }
+    MutexLocker locker{_statsMutex};
+    _writeLatency.record(durationUs);
+}
+
+spiffsGcStats_t SPIFFS_IDFDriver::gcStats() const {
+    MutexLocker locker{_statsMutex};
+    return _gcStats;
+}
+
+latencySummary_t SPIFFS_IDFDriver::writeLatency() const {
+    MutexLocker locker{_statsMutex};
+    return _writeLatency.summary();
+}
+
+void SPIFFS_IDFDriver::resetWriteLatency() {
+    MutexLocker locker{_statsMutex};
+    _writeLatency.reset();
 }
\ No newline at end of file
@@ -1,21 +1,182 @@
 #include "SafeFileManipulator.hpp"
-#include "md5.hpp"
 #include "ThreadSafeDbg.hpp"
+#include "esp_rom_crc.h"
 #include <algorithm>
+#include <unordered_set>
+#include <string_view>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <initializer_list>
 
 static const char* const TAG {"SAFE_SAVER"};
 static const char* const dataExtension {".d"};
 static const char* const md5Extension {".m"};
 static const char* const backupExtension {".b"};
 static const char* const backupPostfix {"_b"};
+static const char* const tempPostfix {"_t"};
+// .m file layout: <digest>[\n<data length>:<hex digest state>], state part is optional for older files
+static const char md5StateDelimiter {'\n'};
+static const char md5StateLengthDelimiter {':'};
+static const char* const framedExtension {".f"};
+static const char* const tempExtension {".t"};
+static const char* const framedTempExtension {".ft"};
+
+static const uint32_t framedMagic {0x46454653};     // "SFEF"
+static const uint8_t framedVersion {2};
+static const uint8_t framedLegacyVersion {1};
+static const size_t framedDigestLength {32};
+static const size_t framedStateLength {192};
+static const uint8_t framedHeaderSlots {2};
+
+// header of version 1 files, single copy rewritten in place on append, only read now
+struct framedFileHeaderV1_t {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t digestType;
+    uint16_t stateLength;
+    uint32_t payloadLength;
+    char digest[framedDigestLength];
+    char state[framedStateLength];
+};
+
+// MODE_FRAMED files start with framedHeaderSlots header slots followed by payload
+// append updates the slot not holding the newest header, torn header write leaves the other one valid
+struct framedFileHeader_t {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t digestType;
+    uint16_t stateLength;
+    uint32_t payloadLength;
+    uint32_t sequence;      // newest valid slot wins
+    uint32_t headerCrc;     // of the slot without this field
+    char digest[framedDigestLength];
+    char state[framedStateLength];
+};
+
+struct framedLayout_t {
+    framedFileHeader_t slots[framedHeaderSlots];    // raw content, slot 0 is rewritten as is when slot 1 is updated
+    uint8_t order[framedHeaderSlots];               // valid slots, newest first
+    uint8_t count;
+    bool legacy;
+    size_t payloadOffset;
+
+    const framedFileHeader_t& newest() const { return slots[order[0]]; }
+};
+
+static uint32_t framedHeaderCrc(const framedFileHeader_t& header) {
+    const uint8_t* const bytes {reinterpret_cast<const uint8_t*>(&header)};
+    const size_t crcOffset {offsetof(framedFileHeader_t, headerCrc)};
+    const size_t tailOffset {crcOffset + sizeof(header.headerCrc)};
+    return esp_rom_crc32_le(esp_rom_crc32_le(0, bytes, crcOffset), bytes + tailOffset, sizeof(header) - tailOffset);
+}
+
+static bool isFramedHeaderValid(const framedFileHeader_t& header, const size_t fileSize, const size_t payloadOffset) {
+    return framedMagic == header.magic
+        and header.digestType <= static_cast<uint8_t>(eDigestType::DIGEST_XXHASH32)
+        and header.stateLength <= framedStateLength
+        and fileSize >= payloadOffset + header.payloadLength;
+}
+
+static bool readFramedLayout(IFileReader& reader, framedLayout_t& layout) {
+
+    char* const raw {reinterpret_cast<char*>(layout.slots)};
+    static_assert(sizeof(layout.slots) > sizeof(framedFileHeaderV1_t));
 
+    if (sizeof(framedFileHeaderV1_t) != reader.read({raw, sizeof(framedFileHeaderV1_t)})) {
+        return false;
+    }
+
+    layout.count = 0;
+    // version byte has the same offset in both layouts
+    layout.legacy = framedLegacyVersion == layout.slots[0].version;
+
+    if (true == layout.legacy) {
+        framedFileHeaderV1_t legacy {};
+        memcpy(&legacy, raw, sizeof(legacy));
+        framedFileHeader_t& header {layout.slots[0]};
+        memset(&header, 0, sizeof(header));
+        header.magic = legacy.magic;
+        header.version = legacy.version;
+        header.digestType = legacy.digestType;
+        header.stateLength = legacy.stateLength;
+        header.payloadLength = legacy.payloadLength;
+        memcpy(header.digest, legacy.digest, framedDigestLength);
+        memcpy(header.state, legacy.state, framedStateLength);
+        layout.payloadOffset = sizeof(legacy);
+        if (true == isFramedHeaderValid(header, reader.size(), layout.payloadOffset)) {
+            layout.order[layout.count++] = 0;
+        }
+        return 0 != layout.count;
+    }
+
+    const size_t rest {sizeof(layout.slots) - sizeof(framedFileHeaderV1_t)};
+    if (rest != reader.read({raw + sizeof(framedFileHeaderV1_t), rest})) {
+        return false;
+    }
+    layout.payloadOffset = sizeof(layout.slots);
+
+    for (uint8_t slot = 0; slot < framedHeaderSlots; ++slot) {
+        const framedFileHeader_t& header {layout.slots[slot]};
+        if (framedVersion == header.version and framedHeaderCrc(header) == header.headerCrc
+                and true == isFramedHeaderValid(header, reader.size(), layout.payloadOffset)) {
+            layout.order[layout.count++] = slot;
+        }
+    }
+
+    if (framedHeaderSlots == layout.count and layout.slots[layout.order[1]].sequence > layout.slots[layout.order[0]].sequence) {
+        std::swap(layout.order[0], layout.order[1]);
+    }
+    return 0 != layout.count;
+}
 
-SafeFileManipulator::SafeFileManipulator(const eSafeFileSaverMode mode, IFileSystemDriver* driver) 
+static void fillFramedHeader(framedFileHeader_t& header, Digest& digest, const size_t payloadLength, const uint32_t sequence) {
+
+    const std::string state {digest.saveState()};
+    const std::string digestString {digest.finish()};
+
+    memset(&header, 0, sizeof(header));
+    header.magic = framedMagic;
+    header.version = framedVersion;
+    header.digestType = static_cast<uint8_t>(digest.type());
+    header.payloadLength = payloadLength;
+    header.sequence = sequence;
+    memcpy(header.digest, digestString.data(), std::min(digestString.length(), framedDigestLength));
+
+    // without saved state next append rewrites the whole file
+    if (state.length() <= framedStateLength) {
+        header.stateLength = state.length();
+        memcpy(header.state, state.data(), state.length());
+    }
+    header.headerCrc = framedHeaderCrc(header);
+}
+
+
+static uint64_t fileNameHash(const std::string_view name) {
+    // FNV-1a
+    uint64_t hash {14695981039346656037ULL};
+    for (const char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+SafeFileManipulator::SafeFileManipulator(const eSafeFileSaverMode mode, IFileSystemDriver* driver, const eDigestType digestType) 
                 :   IFileManipulator(driver), 
-                    _mode(mode) {
+                    _mode(mode),
+                    _digestType(digestType) {
 }
 
-bool SafeFileManipulator::saveContentToFile(const string& content, const string& filename) const {
+bool SafeFileManipulator::saveContentToFile(std::string_view content, const string& filename) const {
+
+    if (true == _skipUnchangedWrites and eSafeFileSaverMode::MODE_NORMAL != _mode) {
+        if (true == isContentUnchanged(content, filename)) {
+            _dedupStats.hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        _dedupStats.misses.fetch_add(1, std::memory_order_relaxed);
+    }
 
     switch (_mode) {
         case eSafeFileSaverMode::MODE_NORMAL:
@@ -26,6 +187,9 @@ bool SafeFileManipulator::saveContentToFile(const string& content, const string&
 
         case eSafeFileSaverMode::MODE_USE_MD5_AND_BACKUP:
             return saveInMd5BackupMode(content, filename, false);
+
+        case eSafeFileSaverMode::MODE_FRAMED:
+            return saveInFramedMode(content, filename, false);
     
         default:
             assert(false);
@@ -44,6 +208,9 @@ std::pair<bool, std::string> SafeFileManipulator::loadContentFromFile(const stri
 
         case eSafeFileSaverMode::MODE_USE_MD5_AND_BACKUP:
             return loadInMd5BackupMode(filename);
+
+        case eSafeFileSaverMode::MODE_FRAMED:
+            return loadInFramedMode(filename);
     
         default:
             assert(false);
@@ -52,7 +219,7 @@ std::pair<bool, std::string> SafeFileManipulator::loadContentFromFile(const stri
     return std::make_pair(false, "");
 }
 
-bool SafeFileManipulator::appendContentToFile(const string& content, const string& filename) const {
+bool SafeFileManipulator::appendContentToFile(std::string_view content, const string& filename) const {
     switch (_mode) {
         case eSafeFileSaverMode::MODE_NORMAL:
             return saveInNormalMode(content, filename, true);
@@ -62,6 +229,9 @@ bool SafeFileManipulator::appendContentToFile(const string& content, const strin
 
         case eSafeFileSaverMode::MODE_USE_MD5_AND_BACKUP:
             return saveInMd5BackupMode(content, filename, true);
+
+        case eSafeFileSaverMode::MODE_FRAMED:
+            return saveInFramedMode(content, filename, true);
     
         default:
             assert(false);
@@ -70,7 +240,7 @@ bool SafeFileManipulator::appendContentToFile(const string& content, const strin
     return false;
 }
 
-bool SafeFileManipulator::saveInNormalMode(const string& content, const string& filename, const bool append) const {
+bool SafeFileManipulator::saveInNormalMode(std::string_view content, const string& filename, const bool append) const {
 
     bool res = false;
     static const uint8_t maxSaveTriesInNormalMode = 3;
@@ -84,68 +254,223 @@ bool SafeFileManipulator::saveInNormalMode(const string& content, const string&
     return res;
 }
 
-bool SafeFileManipulator::saveInMd5Mode(const string& content, const string& filename, const bool append) const {
+bool SafeFileManipulator::saveInMd5Mode(std::string_view content, const string& filename, const bool append) const {
 
     bool res = false;
     static const uint8_t maxSaveTriesInMd5Mode = 3;
     uint8_t currentTry = 0;
-    const string mainFileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MAIN);
-    const string mainMd5FileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_MAIN);
+    const FilePath mainFileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MAIN);
+    const FilePath mainMd5FileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_MAIN);
+    const FilePath tempFileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_TEMP);
+    const FilePath tempMd5FileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_TEMP);
+
+    // temp files may hold the only valid pair of an interrupted commit, settle it before the names are reused
+    if (true == _driver->doesFileExist(tempFileName) or true == _driver->doesFileExist(tempMd5FileName)) {
+        loadInMd5Mode(filename);
+        _driver->deleteFile(tempFileName);
+        _driver->deleteFile(tempMd5FileName);
+    }
 
     while (res != true and currentTry < maxSaveTriesInMd5Mode) {
         ++currentTry;
         // DBG_PRINT_TAG(TAG, "Saving in MD5 mode, append: %s, current try: %u", append? "true":"false", currentTry);
-        const bool mainFileUpdated = append? _driver->appendContentToFile(content, mainFileName) : _driver->writeContentToFile(content, mainFileName);
-        if (false == mainFileUpdated) {
+        Digest digest{_digestType};
+        size_t dataLength {0};
+
+        if (true == append and false == resumeDigest(mainFileName, mainMd5FileName, digest, dataLength)) {
+            // tail of an interrupted append is not covered by .m, valid part is rewritten with the new content
+            auto loaded {loadInMd5Mode(filename)};
+            if (false == loaded.first) {
+                DBG_PRINT_TAG(TAG, "can't append to corrupted file: %s", filename.c_str());
+                return false;
+            }
+            loaded.second.append(content);
+            return saveInMd5Mode(loaded.second, filename, false);
+        }
+
+        // current pair stays valid until both new files are on flash
+        const bool dataFileWritten = append? writeAndSync(mainFileName, {content}, eWriteMode::WRITE_APPEND) :
+            writeAndSync(tempFileName, {content});
+        if (false == dataFileWritten) {
             DBG_PRINT_TAG(TAG, "Failed to save mainFile");
             continue;
         }
 
-        const string mainFileMd5 = _driver->getFileMd5(mainFileName);
+        digest.update(content);
+        dataLength += content.length();
+        const string md5FileContent {makeMd5FileContent(digest, dataLength)};
 
-        if (false == _driver->writeContentToFile(mainFileMd5, mainMd5FileName)) {
+        if (false == writeAndSync(tempMd5FileName, {md5FileContent})) {
             DBG_PRINT_TAG(TAG, "failed to write MD5");
             continue;
         }
 
         string readMd5 = "";
 
-        if (false == _driver->readEntireFileToString(mainMd5FileName, readMd5)) {
+        if (false == _driver->readEntireFileToString(tempMd5FileName, readMd5)) {
             DBG_PRINT_TAG(TAG, "Failed to read MD5 from .md5 file");
             continue;
         }
-        const bool isMd5FileUpdated = readMd5.compare(mainFileMd5) == 0;
+        const bool isMd5FileUpdated = readMd5.compare(md5FileContent) == 0;
 
         if (false == isMd5FileUpdated) {
             DBG_PRINT_TAG(TAG, ".md5 is not properly updated!");
             continue;
         }
+
+        // load finishes these renames if power is lost in between
+        if (false == _driver->renameFile(tempMd5FileName, mainMd5FileName)
+                or (false == append and false == _driver->renameFile(tempFileName, mainFileName))) {
+            DBG_PRINT_TAG(TAG, "Failed to commit %s", filename.c_str());
+            continue;
+        }
         res = true;
     }
 
     return res;
 }
 
-std::string SafeFileManipulator::getFileNameWithExtension(const string& filename, const eSafeSaverFileType type) const {
+bool SafeFileManipulator::isContentUnchanged(std::string_view content, const string& filename) const {
+
+    // matching digest is not enough, stored data is verified too so a corrupted copy gets rewritten
+    switch (_mode) {
+        case eSafeFileSaverMode::MODE_USE_MD5: {
+            const FilePath mainFileName {getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MAIN)};
+            std::string md5FileContent {""};
+            auto reader {_driver->openForReading(mainFileName)};
+            if (!reader or reader->size() != content.length()
+                or false == _driver->readEntireFileToString(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_MAIN), md5FileContent)) {
+                return false;
+            }
+            const string storedDigest {digestFromMd5FileContent(md5FileContent)};
+            return storedDigest == Digest::ofString(content, _digestType) and true == isStoredDataIntact(*reader, content.length(), mainFileName, storedDigest);
+        }
+
+        case eSafeFileSaverMode::MODE_USE_MD5_AND_BACKUP:
+        case eSafeFileSaverMode::MODE_FRAMED: {
+            const FilePath framedFileName {getFileNameWithExtension(filename, eSafeSaverFileType::FILE_FRAMED)};
+            auto reader {_driver->openForReading(framedFileName)};
+            framedLayout_t layout {};
+            if (!reader or false == readFramedLayout(*reader, layout)) {
+                return false;
+            }
+            const framedFileHeader_t& header {layout.newest()};
+            if (header.payloadLength != content.length()
+                or reader->size() != layout.payloadOffset + header.payloadLength
+                or header.digestType != static_cast<uint8_t>(_digestType)) {
+                return false;
+            }
+            const string storedDigest(header.digest, strnlen(header.digest, framedDigestLength));
+            // reader is positioned at the payload
+            return storedDigest == Digest::ofString(content, _digestType) and true == isStoredDataIntact(*reader, content.length(), framedFileName, storedDigest);
+        }
+
+        default:
+        break;
+    }
+    return false;
+}
+
+bool SafeFileManipulator::isStoredDataIntact(IFileReader& reader, const size_t length, std::string_view fileName, const string& expectedDigest) const {
+
+    if (true == _driver->isContentVerified(fileName, expectedDigest)) {
+        return true;
+    }
+
+    Digest digest{_digestType};
+    if (false == digest.update(reader, length) or digest.finish() != expectedDigest) {
+        DBG_PRINT_TAG(TAG, "stored data of " PATH_FMT " is corrupted", PATH_ARG(fileName));
+        return false;
+    }
+
+    _driver->setContentVerified(fileName, expectedDigest);
+    return true;
+}
+
+bool SafeFileManipulator::resumeDigest(std::string_view mainFileName, std::string_view md5FileName, Digest& digest, size_t& dataLength) const {
+
+    if (false == _driver->getFileSize(mainFileName, dataLength)) {
+        dataLength = 0;
+        return true;
+    }
+
+    std::string md5FileContent {""};
+    if (true == _driver->readEntireFileToString(md5FileName, md5FileContent)) {
+        const size_t lengthIndex {md5FileContent.find(md5StateDelimiter)};
+        const size_t stateIndex {md5FileContent.find(md5StateLengthDelimiter, lengthIndex)};
+        if (std::string::npos != lengthIndex and std::string::npos != stateIndex) {
+            const size_t savedLength {strtoul(md5FileContent.c_str() + lengthIndex + 1, nullptr, 10)};
+            if (savedLength != dataLength) {
+                DBG_PRINT_TAG(TAG, PATH_FMT " has %u bytes, %u expected", PATH_ARG(mainFileName), static_cast<unsigned>(dataLength), static_cast<unsigned>(savedLength));
+                return false;
+            }
+            if (true == digest.restoreState(md5FileContent.substr(stateIndex + 1))) {
+                return true;
+            }
+        }
+    }
+
+    DBG_PRINT_TAG(TAG, "no valid digest state for " PATH_FMT ", rehashing", PATH_ARG(mainFileName));
+
+    auto reader {_driver->openForReading(mainFileName)};
+    return reader and digest.update(*reader);
+}
+
+std::string SafeFileManipulator::makeMd5FileContent(Digest& digest, const size_t dataLength) const {
+    const std::string state {digest.saveState()};
+    return digest.finish().append(1, md5StateDelimiter).append(std::to_string(dataLength)).append(1, md5StateLengthDelimiter).append(state);
+}
+
+std::string SafeFileManipulator::digestFromMd5FileContent(const std::string& md5FileContent) {
+    return md5FileContent.substr(0, md5FileContent.find(md5StateDelimiter));
+}
+
+FilePath SafeFileManipulator::getFileNameWithExtension(std::string_view filename, const eSafeSaverFileType type) const {
+
+    const char* postfix {""};
+    const char* extension {""};
 
     switch (type) {
         case eSafeSaverFileType::FILE_MAIN:
-            return string(filename).append(dataExtension);
+            extension = dataExtension;
+        break;
 
         case eSafeSaverFileType::FILE_BACKUP:
-            return string(filename).append(backupExtension);
+            extension = backupExtension;
+        break;
 
         case eSafeSaverFileType::FILE_MD5_MAIN:
-            return string(filename).append(md5Extension);
+            extension = md5Extension;
+        break;
 
         case eSafeSaverFileType::FILE_MD5_BACKUP:
-            return string(filename).append(backupPostfix).append(md5Extension);
+            postfix = backupPostfix;
+            extension = md5Extension;
+        break;
+
+        case eSafeSaverFileType::FILE_MD5_TEMP:
+            postfix = tempPostfix;
+            extension = md5Extension;
+        break;
+
+        case eSafeSaverFileType::FILE_FRAMED:
+            extension = framedExtension;
+        break;
+
+        case eSafeSaverFileType::FILE_TEMP:
+            extension = tempExtension;
+        break;
+
+        case eSafeSaverFileType::FILE_FRAMED_TEMP:
+            extension = framedTempExtension;
+        break;
 
         default:
             assert(false);
-        break;
+            return FilePath{""};
     }
-    return "";
+
+    return FilePath{filename, postfix, extension};
 }
 
 std::pair<bool, std::string> SafeFileManipulator::loadInNormalMode(const string& filename) const {
@@ -160,53 +485,352 @@ std::pair<bool, std::string> SafeFileManipulator::loadInNormalMode(const string&
 
 std::pair<bool, std::string> SafeFileManipulator::loadInMd5Mode(const string& filename) const {
     
-    const string mainFileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MAIN);
-    const string mainMd5FileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_MAIN);
+    const FilePath mainFileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MAIN);
+    const FilePath mainMd5FileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_MAIN);
 
-    if (false == doesFileExist(filename)) {
-        return std::make_pair(false, "");
+    auto loaded {loadMd5Pair(mainFileName, mainMd5FileName)};
+
+    if (true == loaded.first) {
+        return loaded;
     }
 
+    const FilePath tempFileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_TEMP);
+    const FilePath tempMd5FileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_TEMP);
+    const bool tempExists[] {_driver->doesFileExist(tempFileName), _driver->doesFileExist(tempMd5FileName)};
+
+    // commit was interrupted after both new files were written, finish the renames
+    const std::pair<const FilePath*, const FilePath*> pairs[] {
+        {&mainFileName, &tempMd5FileName},
+        {&tempFileName, &mainMd5FileName},
+        {&tempFileName, &tempMd5FileName},
+    };
+
+    for (const auto& [dataFileName, md5FileName] : pairs) {
+        const bool isTempData {dataFileName == &tempFileName};
+        const bool isTempMd5 {md5FileName == &tempMd5FileName};
+        if ((true == isTempData and false == tempExists[0]) or (true == isTempMd5 and false == tempExists[1])) {
+            continue;
+        }
+
+        loaded = loadMd5Pair(*dataFileName, *md5FileName);
+        if (true == loaded.first) {
+            DBG_PRINT_TAG(TAG, "finishing interrupted commit of %s", filename.c_str());
+            if (true == isTempMd5) {
+                _driver->renameFile(tempMd5FileName, mainMd5FileName);
+            }
+            if (true == isTempData) {
+                _driver->renameFile(tempFileName, mainFileName);
+            }
+            return loaded;
+        }
+    }
+
+    return std::make_pair(false, "");
+}
+
+std::pair<bool, std::string> SafeFileManipulator::loadMd5Pair(std::string_view dataFileName, std::string_view md5FileName) const {
+
     std::string md5FileContent {""};
-    if (false == _driver->readEntireFileToString(mainMd5FileName, md5FileContent)) {
+    if (false == _driver->readEntireFileToString(md5FileName, md5FileContent)) {
         return std::make_pair(false, "");
     }
 
     std::string fileContent {""};
-    if (false == _driver->readEntireFileToString(mainFileName, fileContent)) {
+    if (false == _driver->readEntireFileToString(dataFileName, fileContent)) {
         return std::make_pair(false, "");
     }
 
-    const string contentMd5 = getMD5String(fileContent);
+    // bytes past the stored length are left by an interrupted append
+    const size_t lengthIndex {md5FileContent.find(md5StateDelimiter)};
+    if (std::string::npos != lengthIndex) {
+        const size_t savedLength {strtoul(md5FileContent.c_str() + lengthIndex + 1, nullptr, 10)};
+        if (savedLength > fileContent.length()) {
+            return std::make_pair(false, "");
+        }
+        fileContent.resize(savedLength);
+    }
+
+    const string expectedMd5 {digestFromMd5FileContent(md5FileContent)};
+
+    if (true == _driver->isContentVerified(dataFileName, expectedMd5)) {
+        return std::make_pair(true, fileContent);
+    }
 
-    if(contentMd5.compare(md5FileContent) != 0) {
+    const string contentMd5 = Digest::ofString(fileContent, _digestType);
+
+    if(contentMd5.compare(expectedMd5) != 0) {
         return std::make_pair(false, "");
     }
-    
+
+    _driver->setContentVerified(dataFileName, expectedMd5);
     return std::make_pair(true, fileContent);
 }
 
 std::pair<bool, std::string> SafeFileManipulator::loadInMd5BackupMode(const string& filename) const {
-    // TODO: Will be implemented later
+
+    // newest first: primary, temp left by an interrupted commit, then previous version
+    for (const auto type : {eSafeSaverFileType::FILE_FRAMED, eSafeSaverFileType::FILE_FRAMED_TEMP, eSafeSaverFileType::FILE_BACKUP}) {
+        auto loaded {loadFramedFile(getFileNameWithExtension(filename, type))};
+        if (true == loaded.first) {
+            return loaded;
+        }
+    }
     return std::make_pair(false, "");
 }
 
-bool SafeFileManipulator::saveInMd5BackupMode(const string& content, const string& filename, const bool append) const {
-    // TODO: Will be implemented later
+bool SafeFileManipulator::saveInMd5BackupMode(std::string_view content, const string& filename, const bool append) const {
+
+    static const uint8_t maxSaveTriesInBackupMode = 3;
+
+    // primary is a framed file, append extends it in place, backup is rotated only by full saves
+    if (true == append and true == appendToFramedFile(content, filename)) {
+        return true;
+    }
+
+    std::string newContent {""};
+
+    if (true == append) {
+        auto loaded {loadInMd5BackupMode(filename)};
+        if (false == loaded.first and true == doesFileExist(filename)) {
+            DBG_PRINT_TAG(TAG, "can't append to corrupted file: %s", filename.c_str());
+            return false;
+        }
+        newContent.swap(loaded.second);
+        newContent.append(content);
+    }
+
+    const std::string_view contentToWrite {append ? std::string_view{newContent} : content};
+
+    for (uint8_t currentTry = 0; currentTry < maxSaveTriesInBackupMode; ++currentTry) {
+        if (true == commitFramedFile(contentToWrite, filename, true)) {
+            return true;
+        }
+        DBG_PRINT_TAG(TAG, "Failed to save in backup mode, current try: %u", currentTry + 1);
+    }
+    return false;
+}
+
+bool SafeFileManipulator::saveInFramedMode(std::string_view content, const string& filename, const bool append) const {
+
+    static const uint8_t maxSaveTriesInFramedMode = 3;
+
+    if (true == append and true == appendToFramedFile(content, filename)) {
+        return true;
+    }
+
+    std::string newContent {""};
+
+    if (true == append) {
+        // load migrates legacy md5 files, so append continues their content
+        auto loaded {loadInFramedMode(filename)};
+        if (false == loaded.first and true == _driver->doesFileExist(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_FRAMED))) {
+            DBG_PRINT_TAG(TAG, "can't append to corrupted file: %s", filename.c_str());
+            return false;
+        }
+        newContent.swap(loaded.second);
+        newContent.append(content);
+    }
+
+    const std::string_view contentToWrite {append ? std::string_view{newContent} : content};
+
+    for (uint8_t currentTry = 0; currentTry < maxSaveTriesInFramedMode; ++currentTry) {
+        if (true == commitFramedFile(contentToWrite, filename, false)) {
+            return true;
+        }
+        DBG_PRINT_TAG(TAG, "Failed to save framed file, current try: %u", currentTry + 1);
+    }
+
     return false;
 }
 
+bool SafeFileManipulator::commitFramedFile(std::string_view content, const string& filename, const bool keepBackup) const {
+
+    const FilePath framedFileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_FRAMED);
+    const FilePath tempFileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_FRAMED_TEMP);
+
+    Digest digest{_digestType};
+    digest.update(content);
+    framedFileHeader_t headers[framedHeaderSlots] {};
+    fillFramedHeader(headers[0], digest, content.length(), 1);
+
+    if (false == writeAndSync(tempFileName, {{reinterpret_cast<const char*>(headers), sizeof(headers)}, content})) {
+        return false;
+    }
+
+    // rotation is rename only, fails harmlessly if there is no primary file yet
+    if (true == keepBackup) {
+        _driver->renameFile(framedFileName, getFileNameWithExtension(filename, eSafeSaverFileType::FILE_BACKUP));
+    }
+
+    // replace is not atomic on every filesystem, load falls back to temp if it was interrupted
+    if (false == _driver->renameFile(tempFileName, framedFileName)) {
+        DBG_PRINT_TAG(TAG, "failed to commit %s", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool SafeFileManipulator::writeAndSync(std::string_view fileName, std::initializer_list<std::span<const char>> parts, const eWriteMode mode) const {
+
+    auto writer {_driver->openForWriting(fileName, mode)};
+    if (!writer) {
+        return false;
+    }
+
+    bool written {true};
+    for (const auto& part : parts) {
+        written = written and part.size() == writer->write(part);
+    }
+    written = written and writer->sync();
+
+    if (false == writer->close() or false == written) {
+        DBG_PRINT_TAG(TAG, "failed to write " PATH_FMT, PATH_ARG(fileName));
+        // partially written file is useless only if it was created from scratch
+        if (eWriteMode::WRITE_TRUNCATE == mode) {
+            _driver->deleteFile(fileName);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool SafeFileManipulator::appendToFramedFile(std::string_view content, const string& filename) const {
+
+    const FilePath framedFileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_FRAMED);
+    framedLayout_t layout {};
+
+    {
+        auto reader {_driver->openForReading(framedFileName)};
+        // size mismatch means previous append was interrupted, legacy files are upgraded, both rewrite the whole file
+        if (!reader or false == readFramedLayout(*reader, layout) or true == layout.legacy
+                or reader->size() != layout.payloadOffset + layout.newest().payloadLength) {
+            return false;
+        }
+    }
+
+    const framedFileHeader_t& newest {layout.newest()};
+    Digest digest{_digestType};
+
+    if (newest.digestType != static_cast<uint8_t>(_digestType) or false == digest.restoreState(std::string(newest.state, newest.stateLength))) {
+        return false;
+    }
+
+    // payload has to be durable before any header covers it
+    if (false == writeAndSync(framedFileName, {content}, eWriteMode::WRITE_APPEND)) {
+        return false;
+    }
+
+    digest.update(content);
+    const uint8_t slot = layout.order[0] ^ 1;
+    fillFramedHeader(layout.slots[slot], digest, newest.payloadLength + content.length(), newest.sequence + 1);
+
+    // there is no seek, slot 0 is written back unchanged in front of slot 1
+    return writeAndSync(framedFileName, {{reinterpret_cast<const char*>(layout.slots), (slot + 1) * sizeof(framedFileHeader_t)}}, eWriteMode::WRITE_OVERWRITE);
+}
+
+std::pair<bool, std::string> SafeFileManipulator::loadInFramedMode(const string& filename) const {
+
+    auto loaded {loadFramedFile(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_FRAMED))};
+
+    if (false == loaded.first) {
+        // interrupted rename may leave only the temp file
+        loaded = loadFramedFile(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_FRAMED_TEMP));
+    }
+
+    // legacy md5 files are dealt with here once, saves don't look for them
+    if (true == loaded.first) {
+        dropLegacyFiles(filename);
+        return loaded;
+    }
+
+    if (true == migrateToFramed(filename)) {
+        return loadFramedFile(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_FRAMED));
+    }
+    return std::make_pair(false, "");
+}
+
+std::pair<bool, std::string> SafeFileManipulator::loadFramedFile(std::string_view framedFileName) const {
+
+    auto reader {_driver->openForReading(framedFileName)};
+    framedLayout_t layout {};
+
+    if (!reader or false == readFramedLayout(*reader, layout)) {
+        return std::make_pair(false, "");
+    }
+
+    // payload only grows between headers, older slot covers a prefix of the newest one
+    size_t payloadLength {0};
+    for (uint8_t i = 0; i < layout.count; ++i) {
+        payloadLength = std::max<size_t>(payloadLength, layout.slots[layout.order[i]].payloadLength);
+    }
+
+    std::string content(payloadLength, '\0');
+
+    if (payloadLength != reader->read(content)) {
+        return std::make_pair(false, "");
+    }
+
+    for (uint8_t i = 0; i < layout.count; ++i) {
+        const framedFileHeader_t& header {layout.slots[layout.order[i]]};
+        const std::string_view payload {content.data(), header.payloadLength};
+        const string expectedDigest(header.digest, strnlen(header.digest, framedDigestLength));
+
+        if (false == _driver->isContentVerified(framedFileName, expectedDigest)) {
+            Digest digest{static_cast<eDigestType>(header.digestType)};
+            digest.update(payload);
+            if (digest.finish() != expectedDigest) {
+                DBG_PRINT_TAG(TAG, "digest mismatch: " PATH_FMT ", slot %u", PATH_ARG(framedFileName), layout.order[i]);
+                continue;
+            }
+            _driver->setContentVerified(framedFileName, expectedDigest);
+        }
+
+        content.resize(header.payloadLength);
+        return std::make_pair(true, content);
+    }
+
+    return std::make_pair(false, "");
+}
+
+bool SafeFileManipulator::migrateToFramed(const string& filename) const {
+
+    if (false == _driver->doesFileExist(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_MAIN))) {
+        return false;
+    }
+
+    const auto legacy {loadInMd5Mode(filename)};
+    if (false == legacy.first or false == commitFramedFile(legacy.second, filename, false)) {
+        DBG_PRINT_TAG(TAG, "failed to migrate %s", filename.c_str());
+        return false;
+    }
+
+    DBG_PRINT_TAG(TAG, "%s migrated to framed format", filename.c_str());
+    dropLegacyFiles(filename);
+    return true;
+}
+
+void SafeFileManipulator::dropLegacyFiles(const string& filename) const {
+
+    const FilePath md5FileName = getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_MAIN);
+    if (false == _driver->doesFileExist(md5FileName)) {
+        return;
+    }
+
+    // framed file is always newer, legacy pair is only written by md5 mode
+    _driver->deleteFile(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MAIN));
+    _driver->deleteFile(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_TEMP));
+    _driver->deleteFile(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_TEMP));
+    _driver->deleteFile(md5FileName);
+}
+
 uint32_t SafeFileManipulator::countFilesInDirectory(const std::string& directory) const {
 
     if (eSafeFileSaverMode::MODE_NORMAL == _mode) {
         return _driver->countFiles(directory);
     }
 
-    else if (eSafeFileSaverMode::MODE_USE_MD5 == _mode) {
-        return dataFilesList(directory).size();
-    }
-
-    return 0;
+    // names are only needed for pairing, hashes are enough to count
+    return collectDataFiles<uint64_t>(directory, fileNameHash).size();
 }
 
 std::vector<std::string> SafeFileManipulator::dataFilesList (const std::string& directory) const {
@@ -214,39 +838,59 @@ std::vector<std::string> SafeFileManipulator::dataFilesList (const std::string&
     if (eSafeFileSaverMode::MODE_NORMAL == _mode) {
         return _driver->filesList(directory);
     }
-    
-    else if (eSafeFileSaverMode::MODE_USE_MD5 == _mode) {
-        std::vector<std::string> allFilesList {_driver->filesList(directory)};
-        std::vector<std::string> dataFilesList;
-
-        for (auto it = allFilesList.begin(); it != allFilesList.end();) {
-            const size_t dotIndex {it->find_first_of('.')};
-            if (std::string::npos == dotIndex) {
-                allFilesList.erase(it);
-                continue;
-            }
-            it ++;
-        }
 
-        for (auto it = allFilesList.begin(); it != allFilesList.end();) {
-            const size_t dotIndex {it->find_first_of('.')};
-            const std::string extension {it->substr(dotIndex)};
-            if (extension == dataExtension) {
-                const std::string filename {it->substr(0, dotIndex)};
-                const std::string md5FileName {filename + md5Extension};
-                const auto md5File = std::find(allFilesList.begin(), allFilesList.end(), md5FileName);
-                if (md5File != allFilesList.end()) {
-                    dataFilesList.push_back(filename);
-                }
+    return collectDataFiles<std::string>(directory, [](const std::string_view name) { return std::string{name}; });
+}
+
+template<typename key_t, typename keyOf_t>
+std::vector<key_t> SafeFileManipulator::collectDataFiles(const std::string& directory, keyOf_t keyOf) const {
+
+    std::vector<key_t> ret;
+    std::vector<key_t> dataFiles;
+    std::unordered_set<key_t> md5Files;
+    std::unordered_set<key_t> listedFiles;
+
+    auto dir {_driver->openDirectory(directory)};
+    if (!dir) {
+        return ret;
+    }
+
+    const bool isFramedLayout {eSafeFileSaverMode::MODE_FRAMED == _mode or eSafeFileSaverMode::MODE_USE_MD5_AND_BACKUP == _mode};
 
-                allFilesList.erase(it);
+    while (const char* const entry = dir->next()) {
+        const std::string_view file {entry};
+        const size_t dotIndex {file.find_first_of('.')};
+        if (std::string_view::npos == dotIndex) {
             continue;
+        }
+        const std::string_view extension {file.substr(dotIndex)};
+        const std::string_view filename {file.substr(0, dotIndex)};
+
+        if (extension == md5Extension) {
+            md5Files.insert(keyOf(filename));
+        }
+        else if (extension == dataExtension) {
+            dataFiles.push_back(keyOf(filename));
+        }
+        else if (true == isFramedLayout and (extension == framedExtension or
+                (eSafeFileSaverMode::MODE_USE_MD5_AND_BACKUP == _mode and extension == backupExtension))) {
+            key_t key {keyOf(filename)};
+            if (true == listedFiles.insert(key).second) {
+                ret.push_back(std::move(key));
             }
-            it ++;
         }
-        return dataFilesList;
     }
-    return {};
+
+    // .d files count only with their .m pair, in MODE_FRAMED such pairs are migrated on first access
+    if (eSafeFileSaverMode::MODE_USE_MD5 == _mode or eSafeFileSaverMode::MODE_FRAMED == _mode) {
+        for (auto& key : dataFiles) {
+            if (md5Files.count(key) and false == listedFiles.count(key)) {
+                ret.push_back(std::move(key));
+            }
+        }
+    }
+
+    return ret;
 }
 
 bool SafeFileManipulator::doesFileExist(const string& filename) const {
@@ -255,13 +899,23 @@ bool SafeFileManipulator::doesFileExist(const string& filename) const {
         case eSafeFileSaverMode::MODE_NORMAL:
             return _driver->doesFileExist(filename);
         case eSafeFileSaverMode::MODE_USE_MD5: {
-            const std::string dataFileName {getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MAIN)};
-            const std::string md5FileName {getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_MAIN)};
-            return ( _driver->doesFileExist(dataFileName) and _driver->doesFileExist(md5FileName) );
+            // temp files count as well, load finishes an interrupted commit
+            return ( (_driver->doesFileExist(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MAIN))
+                    or _driver->doesFileExist(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_TEMP)))
+                and (_driver->doesFileExist(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_MAIN))
+                    or _driver->doesFileExist(getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_TEMP))) );
+        }
+        case eSafeFileSaverMode::MODE_USE_MD5_AND_BACKUP: {
+            const FilePath framedFileName {getFileNameWithExtension(filename, eSafeSaverFileType::FILE_FRAMED)};
+            const FilePath backupFileName {getFileNameWithExtension(filename, eSafeSaverFileType::FILE_BACKUP)};
+            return ( _driver->doesFileExist(framedFileName) or _driver->doesFileExist(backupFileName) );
+        }
+        case eSafeFileSaverMode::MODE_FRAMED: {
+            const FilePath framedFileName {getFileNameWithExtension(filename, eSafeSaverFileType::FILE_FRAMED)};
+            const FilePath dataFileName {getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MAIN)};
+            const FilePath md5FileName {getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_MAIN)};
+            return ( _driver->doesFileExist(framedFileName) or (_driver->doesFileExist(dataFileName) and _driver->doesFileExist(md5FileName)) );
         }
-        case eSafeFileSaverMode::MODE_USE_MD5_AND_BACKUP:
-            // TODO : will be implemented later
-            return false;
     
         default:
             assert(false); // shouldn't be here
@@ -270,35 +924,50 @@ bool SafeFileManipulator::doesFileExist(const string& filename) const {
 }
 
 bool SafeFileManipulator::deleteFile(const std::string& filename) const {
+    return _driver->deleteMany(storedFileNames(filename));
+}
+
+std::vector<std::string> SafeFileManipulator::storedFileNames(const std::string& filename) const {
+
+    const auto name {[this, &filename](const eSafeSaverFileType type) { return std::string{getFileNameWithExtension(filename, type)}; }};
 
     switch (_mode) {
         case eSafeFileSaverMode::MODE_NORMAL:
-            return _driver->deleteFile(filename);
-        case eSafeFileSaverMode::MODE_USE_MD5: {
-            const std::string dataFileName {getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MAIN)};
-            const std::string md5FileName {getFileNameWithExtension(filename, eSafeSaverFileType::FILE_MD5_MAIN)};
-            return ( _driver->deleteFile(dataFileName) and _driver->deleteFile(md5FileName) );
-        }
+            return {filename};
+        case eSafeFileSaverMode::MODE_USE_MD5:
+            return {name(eSafeSaverFileType::FILE_MAIN),
+                name(eSafeSaverFileType::FILE_MD5_MAIN),
+                name(eSafeSaverFileType::FILE_TEMP),
+                name(eSafeSaverFileType::FILE_MD5_TEMP)};
         case eSafeFileSaverMode::MODE_USE_MD5_AND_BACKUP:
-            // TODO : will be implemented later
-            return true;
+            return {name(eSafeSaverFileType::FILE_FRAMED),
+                name(eSafeSaverFileType::FILE_FRAMED_TEMP),
+                name(eSafeSaverFileType::FILE_BACKUP)};
+        case eSafeFileSaverMode::MODE_FRAMED:
+            // md5 mode files are legacy leftovers, migrated on load
+            return {name(eSafeSaverFileType::FILE_FRAMED),
+                name(eSafeSaverFileType::FILE_FRAMED_TEMP),
+                name(eSafeSaverFileType::FILE_MAIN),
+                name(eSafeSaverFileType::FILE_MD5_MAIN),
+                name(eSafeSaverFileType::FILE_TEMP),
+                name(eSafeSaverFileType::FILE_MD5_TEMP)};
     
         default:
             assert(false); // shouldn't be here
         break;
     }
+    return {};
 }
 
 bool SafeFileManipulator::deleteAllFiles(const std::string& directory) const {
 
-    bool ret {true};
-    std::vector<std::string> filesInDirectory {dataFilesList(directory)};
+    std::vector<std::string> filesToDelete {};
 
-    for (auto &file : filesInDirectory) {
-        if(false == deleteFile(file)) {
-            ret = false;
-            break;
+    // listed names are relative to directory
+    for (const auto& file : dataFilesList(directory)) {
+        for (auto& storedFile : storedFileNames(directory + "/" + file)) {
+            filesToDelete.push_back(std::move(storedFile));
         }
     }
-    return ret;
+    return _driver->deleteMany(filesToDelete);
 }
\ No newline at end of file
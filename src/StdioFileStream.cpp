@@ -0,0 +1,97 @@
+#include "StdioFileStream.hpp"
+#include <assert.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+const char* openModeString(const eWriteMode mode) {
+    switch (mode) {
+        case eWriteMode::WRITE_APPEND:
+            return "a";
+        case eWriteMode::WRITE_OVERWRITE:
+            return "r+";
+        case eWriteMode::WRITE_TRUNCATE:
+        default:
+            return "w";
+    }
+}
+
+bool makeParentDirectories(std::string_view path, const size_t prefixLength) {
+    for (size_t pos = path.find('/', prefixLength + 1); std::string_view::npos != pos; pos = path.find('/', pos + 1)) {
+        const std::string_view directory {path.substr(0, pos)};
+        // host paths may not fit the stack buffer
+        const FilePath shortPath {directory};
+        const int ret {shortPath.empty() ? mkdir(std::string{directory}.c_str(), 0755) : mkdir(shortPath.c_str(), 0755)};
+        if (0 != ret and EEXIST != errno) {
+            return false;
+        }
+    }
+    return true;
+}
+
+StdioFileReader::StdioFileReader(FILE* file) : _file{file} {
+    assert(nullptr != file);
+    fseek(_file, 0, SEEK_END);
+    const auto fileSize {ftell(_file)};
+    rewind(_file);
+    _size = fileSize > 0 ? static_cast<size_t>(fileSize) : 0;
+}
+
+StdioFileReader::~StdioFileReader() {
+    fclose(_file);
+}
+
+size_t StdioFileReader::read(std::span<char> buffer) {
+    return fread(buffer.data(), 1, buffer.size(), _file);
+}
+
+StdioFileWriter::StdioFileWriter(FILE* file) : _file{file} {
+    assert(nullptr != file);
+}
+
+StdioFileWriter::~StdioFileWriter() {
+    close();
+}
+
+size_t StdioFileWriter::write(std::span<const char> data) {
+    if (!_file) {
+        return 0;
+    }
+    return fwrite(data.data(), 1, data.size(), _file);
+}
+
+bool StdioFileWriter::sync() {
+    if (!_file) {
+        return false;
+    }
+    return 0 == fflush(_file) and 0 == fsync(fileno(_file));
+}
+
+bool StdioFileWriter::close() {
+    if (!_file) {
+        return false;
+    }
+    const bool flushed {0 == fflush(_file)};
+    const bool closed {0 == fclose(_file)};
+    _file = nullptr;
+    return flushed and closed;
+}
+
+
+DirentDirectoryReader::DirentDirectoryReader(DIR* dir) : _dir{dir} {
+    assert(nullptr != dir);
+}
+
+DirentDirectoryReader::~DirentDirectoryReader() {
+    closedir(_dir);
+}
+
+const char* DirentDirectoryReader::next() {
+    struct dirent* entry;
+    while ((entry = readdir(_dir)) != NULL) {
+        if (entry->d_type == DT_REG) {
+            return entry->d_name;
+        }
+    }
+    return nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "WriteBehindDriver.hpp"
+#include "ESP32Utils.hpp"
+#include "mutex_locker.hpp"
+#include "esp_log.h"
+
+static const char* const TAG {"WriteBehindDriver"};
+
+WriteBehindDriver::WriteBehindDriver(IFileSystemDriver* driver, const writeBehindConfig_t& config)
+    :   FileSystemDriverDecorator(driver),
+        _config{config} {
+    assert(0 != _config.maxOpenFiles);
+    _rebootHookId = ESP32Utils::addRebootHook([this]() { flush(); });
+}
+
+WriteBehindDriver::~WriteBehindDriver() {
+    ESP32Utils::removeRebootHook(_rebootHookId);
+    flush();
+}
+
+bool WriteBehindDriver::flush() const {
+    MutexLocker locker{_mutex};
+    return flushAll();
+}
+
+bool WriteBehindDriver::flushExpired() const {
+    MutexLocker locker{_mutex};
+    return flushExpiredLocked();
+}
+
+writeBehindStats_t WriteBehindDriver::stats() const {
+    MutexLocker locker{_mutex};
+    return _stats;
+}
+
+WriteBehindDriver::pendingFile_t& WriteBehindDriver::acquire(std::string_view filename) const {
+
+    const uint32_t now {ESP32Utils::millis()};
+    auto found {_files.find(filename)};
+    if (_files.end() != found) {
+        found->second.lastUsedMs = now;
+        return found->second;
+    }
+
+    if (_files.size() >= _config.maxOpenFiles) {
+        auto lru {_files.begin()};
+        for (auto it = _files.begin(); it != _files.end(); ++it) {
+            if (now - it->second.lastUsedMs > now - lru->second.lastUsedMs) {
+                lru = it;
+            }
+        }
+        release(lru->first, true);
+    }
+
+    auto& file {_files[std::string{filename}]};
+    file.lastUsedMs = now;
+    return file;
+}
+
+bool WriteBehindDriver::writePending(std::string_view filename, pendingFile_t& file, std::span<const char> extra) const {
+
+    if (file.buffer.empty() and extra.empty()) {
+        return true;
+    }
+
+    bool ret {true};
+    if (!file.writer) {
+        file.writer = _driver->openForWriting(filename, eWriteMode::WRITE_APPEND);
+        if (file.writer) {
+            ++_stats.opens;
+        }
+        else {
+            ++_stats.openFailures;
+        }
+    }
+
+    if (!file.writer) {
+        ESP_LOGE(TAG, "failed to open " PATH_FMT ", %zu bytes dropped", PATH_ARG(filename), file.buffer.size() + extra.size());
+        ret = false;
+    }
+    else if (file.buffer.size() != file.writer->write(file.buffer)
+            or extra.size() != file.writer->write(extra)
+            or false == file.writer->sync()) {
+        ESP_LOGE(TAG, "failed to write " PATH_FMT, PATH_ARG(filename));
+        file.writer.reset();
+        ret = false;
+    }
+
+    ++_stats.flushes;
+    if (false == ret) {
+        ++_stats.failures;
+    }
+    // failed data is dropped anyway, otherwise one bad file would hold the whole budget
+    _bufferedBytes -= file.buffer.size();
+    file.buffer.clear();
+    return ret;
+}
+
+void WriteBehindDriver::release(std::string_view filename, const bool keepPending) const {
+    auto found {_files.find(filename)};
+    if (_files.end() == found) {
+        return;
+    }
+    if (keepPending) {
+        writePending(filename, found->second);
+    }
+    else {
+        _bufferedBytes -= found->second.buffer.size();
+    }
+    // closing lets inner driver see final size, e.g. SPIFFS_IDFDriver index
+    if (found->second.writer) {
+        found->second.writer->close();
+    }
+    _files.erase(found);
+}
+
+bool WriteBehindDriver::flushAll() const {
+    bool ret {true};
+    for (auto& [filename, file] : _files) {
+        ret = writePending(filename, file) and ret;
+        if (file.writer) {
+            ret = file.writer->close() and ret;
+        }
+    }
+    _files.clear();
+    return ret;
+}
+
+bool WriteBehindDriver::flushExpiredLocked() const {
+    const uint32_t now {ESP32Utils::millis()};
+    bool ret {true};
+    for (auto& [filename, file] : _files) {
+        if (false == file.buffer.empty() and now - file.firstPendingMs >= _config.maxAgeMs) {
+            ret = writePending(filename, file) and ret;
+        }
+    }
+    return ret;
+}
+
+bool WriteBehindDriver::enforceMemoryBudget() const {
+    bool ret {true};
+    while (_bufferedBytes > _config.memoryBudget) {
+        auto biggest {_files.begin()};
+        for (auto it = _files.begin(); it != _files.end(); ++it) {
+            if (it->second.buffer.size() > biggest->second.buffer.size()) {
+                biggest = it;
+            }
+        }
+        ret = writePending(biggest->first, biggest->second) and ret;
+    }
+    return ret;
+}
+
+bool WriteBehindDriver::appendContentToFile (std::string_view content, std::string_view filename) const {
+
+    MutexLocker locker{_mutex};
+    ++_stats.appends;
+
+    bool ret {flushExpiredLocked()};
+    auto& file {acquire(filename)};
+
+    // big chunks go straight to the handle, buffering them only costs a copy
+    if (content.size() >= _config.flushThreshold) {
+        return writePending(filename, file, content) and ret;
+    }
+
+    if (file.buffer.empty()) {
+        file.firstPendingMs = ESP32Utils::millis();
+    }
+    file.buffer.append(content);
+    _bufferedBytes += content.size();
+
+    if (file.buffer.size() >= _config.flushThreshold) {
+        ret = writePending(filename, file) and ret;
+    }
+    return enforceMemoryBudget() and ret;
+}
+
+bool WriteBehindDriver::writeContentToFile (std::string_view content, std::string_view filename) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    // pending appends would be truncated anyway
+    release(filename, false);
+    return _driver->writeContentToFile(content, filename);
+}
+
+bool WriteBehindDriver::format() const {
+    MutexLocker locker{_mutex};
+    for (auto& [filename, file] : _files) {
+        if (file.writer) {
+            file.writer->close();
+        }
+    }
+    _files.clear();
+    _bufferedBytes = 0;
+    return _driver->format();
+}
+
+bool WriteBehindDriver::deleteFile(std::string_view fullFileName) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    release(fullFileName, false);
+    return _driver->deleteFile(fullFileName);
+}
+
+bool WriteBehindDriver::writeMany(const fileContents_t& files) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    for (const auto& file : files) {
+        release(file.first, false);
+    }
+    return _driver->writeMany(files);
+}
+
+bool WriteBehindDriver::deleteMany(const std::vector<std::string>& filenames) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    for (const auto& filename : filenames) {
+        release(filename, false);
+    }
+    return _driver->deleteMany(filenames);
+}
+
+std::vector<bool> WriteBehindDriver::existsMany(const std::vector<std::string>& filenames) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    std::vector<bool> ret {_driver->existsMany(filenames)};
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        const auto found {_files.find(filenames[i])};
+        if (_files.end() != found and false == found->second.buffer.empty()) {
+            ret[i] = true;
+        }
+    }
+    return ret;
+}
+
+bool WriteBehindDriver::renameFile(std::string_view from, std::string_view to) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    release(from, true);
+    release(to, false);
+    return _driver->renameFile(from, to);
+}
+
+std::vector<std::string> WriteBehindDriver::filesList(const std::string& path) const {
+    MutexLocker locker{_mutex};
+    flushAll();
+    return _driver->filesList(path);
+}
+
+uint32_t WriteBehindDriver::countFiles (const std::string& path) const {
+    MutexLocker locker{_mutex};
+    flushAll();
+    return _driver->countFiles(path);
+}
+
+bool WriteBehindDriver::readEntireFileToString (std::string_view filename, std::string& output) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    release(filename, true);
+    return _driver->readEntireFileToString(filename, output);
+}
+
+bool WriteBehindDriver::readFileToBuffer(std::string_view filename, std::span<char> buffer, size_t& length) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    release(filename, true);
+    return _driver->readFileToBuffer(filename, buffer, length);
+}
+
+bool WriteBehindDriver::doesFileExist(std::string_view filename) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    const auto found {_files.find(filename)};
+    if (_files.end() != found and false == found->second.buffer.empty()) {
+        return true;
+    }
+    return _driver->doesFileExist(filename);
+}
+
+bool WriteBehindDriver::getFileSize(std::string_view filename, size_t& size) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    release(filename, true);
+    return _driver->getFileSize(filename, size);
+}
+
+std::string WriteBehindDriver::getFileMd5(std::string_view filename) const {
+    return getFileDigest(filename, eDigestType::DIGEST_MD5);
+}
+
+std::string WriteBehindDriver::getFileDigest(std::string_view filename, const eDigestType type) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    release(filename, true);
+    return _driver->getFileDigest(filename, type);
+}
+
+fileReader_t WriteBehindDriver::openForReading(std::string_view filename) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    release(filename, true);
+    return _driver->openForReading(filename);
+}
+
+fileWriter_t WriteBehindDriver::openForWriting(std::string_view filename, const eWriteMode mode) const {
+    MutexLocker locker{_mutex};
+    flushExpiredLocked();
+    release(filename, eWriteMode::WRITE_TRUNCATE != mode);
+    return _driver->openForWriting(filename, mode);
+}
+
+directoryReader_t WriteBehindDriver::openDirectory(const std::string& path) const {
+    MutexLocker locker{_mutex};
+    flushAll();
+    return _driver->openDirectory(path);
+}
\ No newline at end of file